@@ -0,0 +1,350 @@
+// Benchmarks the string-building workload from alloc_test.cpp against several memory
+// resource stacks.
+//
+// Usage: alloc_benchmark [--strings N] [--lengths 8,16,...] [--warmup N] [--repetitions N]
+//                        [--max-size BYTES] [--seed N] [--filter SUBSTRING]
+//                        [--format table|csv|json] [--buffer vector|mmap|thp|hugetlb]
+//
+// The input strings are generated before any timing starts. Each repetition builds a fresh
+// resource stack, and only the emplace_back loop is timed (with std::chrono::steady_clock).
+//
+// --buffer selects the memory backing the buffer-based resources. "vector" is a zero-filled
+// std::vector. The other options map the buffer with regular, transparent huge or hugetlb
+// pages (see mapped_buffer.hpp).
+//
+// For each string length, the capped_pool_resource cases use pool options tuned from an
+// untimed profiling run of the same workload (see tune_pool_options()). The buffer_in_use and
+// pool_hit_rate columns are filled in for the resources that report them.
+
+#include "benchmark_support.hpp"
+#include "buddy_buffer_resource.hpp"
+#include "capped_pool_resource.hpp"
+#include "fixed_buffer_resource.hpp"
+#include "instrumented_resource.hpp"
+#include "mapped_buffer.hpp"
+#include "slab_resource.hpp"
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/string.hpp>
+#include <boost/container/pmr/synchronized_pool_resource.hpp>
+#include <boost/container/pmr/unsynchronized_pool_resource.hpp>
+#include <boost/container/pmr/vector.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+namespace bench = irods::experimental::pmr::bench;
+
+struct options
+{
+    std::size_t strings = 75'000;
+    std::vector<std::size_t> lengths{8, 16, 32, 64, 191};
+    std::size_t warmup = 1;
+    std::size_t repetitions = 5;
+    std::size_t max_size = 50'000'000;
+    std::uint32_t seed = 1;
+    std::string filter;
+    bench::output_format format = bench::output_format::table;
+    std::string buffer = "vector";
+};
+
+// Constructs a resource stack, hands the top of the stack to the callback and tears the stack
+// down again. Construction and destruction are not timed.
+using stack_factory = std::function<void(const std::function<void(pmr::memory_resource&)>&)>;
+
+struct benchmark_case
+{
+    std::string name;
+    stack_factory make_stack;
+};
+
+auto parse_lengths(std::string_view _list) -> std::vector<std::size_t>
+{
+    std::vector<std::size_t> lengths;
+
+    while (!_list.empty()) {
+        const auto comma = _list.find(',');
+        lengths.push_back(std::stoul(std::string{_list.substr(0, comma)}));
+        _list = (comma == std::string_view::npos) ? std::string_view{} : _list.substr(comma + 1);
+    }
+
+    return lengths;
+}
+
+auto parse_options(int _argc, char** _argv) -> options
+{
+    options opts;
+
+    for (int i = 1; i < _argc; ++i) {
+        const std::string_view arg = _argv[i];
+
+        if (i + 1 >= _argc) {
+            throw std::invalid_argument{fmt::format("missing value for option [{}]", arg)};
+        }
+
+        const std::string value = _argv[++i];
+
+        if      (arg == "--strings")     { opts.strings = std::stoul(value); }
+        else if (arg == "--lengths")     { opts.lengths = parse_lengths(value); }
+        else if (arg == "--warmup")      { opts.warmup = std::stoul(value); }
+        else if (arg == "--repetitions") { opts.repetitions = std::stoul(value); }
+        else if (arg == "--max-size")    { opts.max_size = std::stoul(value); }
+        else if (arg == "--seed")        { opts.seed = static_cast<std::uint32_t>(std::stoul(value)); }
+        else if (arg == "--filter")      { opts.filter = value; }
+        else if (arg == "--format")      { opts.format = bench::to_output_format(value); }
+        else if (arg == "--buffer")      { opts.buffer = value; }
+        else {
+            throw std::invalid_argument{fmt::format("unknown option [{}]", arg)};
+        }
+    }
+
+    if (opts.repetitions == 0) {
+        throw std::invalid_argument{"--repetitions must be greater than zero"};
+    }
+
+    if (opts.buffer != "vector" && opts.buffer != "mmap" && opts.buffer != "thp" && opts.buffer != "hugetlb") {
+        throw std::invalid_argument{fmt::format("unknown buffer type [{}]", opts.buffer)};
+    }
+
+    return opts;
+}
+
+auto generate_strings(std::size_t _count, std::size_t _length, std::mt19937& _gen) -> std::vector<std::string>
+{
+    constexpr std::string_view charset = "0123456789"
+                                         "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                         "abcdefghijklmnopqrstuvwxyz";
+
+    std::uniform_int_distribution<std::size_t> dist{0, charset.size() - 1};
+    std::vector<std::string> strings(_count);
+
+    for (auto& s : strings) {
+        s.resize(_length);
+        for (auto& c : s) {
+            c = charset[dist(_gen)];
+        }
+    }
+
+    return strings;
+}
+
+// Returns the time, in milliseconds, taken to copy every input into a pmr::vector of pmr::string
+// backed by the given resource. "_inspect" is called (untimed) while the strings still exist.
+auto run_once(pmr::memory_resource& _resource,
+              const std::vector<std::string>& _inputs,
+              const std::function<void()>& _inspect = {}) -> double
+{
+    pmr::vector<pmr::string> strings{&_resource};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& s : _inputs) {
+        strings.emplace_back(s.data(), s.size());
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (_inspect) {
+        _inspect();
+    }
+
+    // Keep the result observable so the loop cannot be optimized away.
+    if (strings.size() != _inputs.size()) {
+        throw std::logic_error{"benchmark produced the wrong number of strings"};
+    }
+
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+// Derives pool options from one run of the workload (see tune_pool_options()).
+auto tune_for(const std::vector<std::string>& _inputs) -> pmr::pool_options
+{
+    ie::instrumented_resource profile{pmr::new_delete_resource()};
+    run_once(profile, _inputs);
+    return ie::tune_pool_options(profile);
+}
+
+// Returns the number of bytes drawn from the buffer and the hit rate of the pools, for the
+// resources that can tell.
+auto inspect(pmr::memory_resource& _resource) -> std::pair<std::optional<std::size_t>, std::optional<double>>
+{
+    if (const auto* fbr = dynamic_cast<ie::fixed_buffer_resource<std::byte>*>(&_resource); fbr) {
+        return {fbr->allocated() + fbr->allocation_overhead(), std::nullopt};
+    }
+
+    const auto from_pool = [](const auto* _cpr) -> std::pair<std::optional<std::size_t>, std::optional<double>> {
+        const auto s = _cpr->statistics();
+
+        if (s.pooled_requests == 0) {
+            return {s.buffer_in_use, std::nullopt};
+        }
+
+        return {s.buffer_in_use, s.hit_rate()};
+    };
+
+    if (const auto* cpr = dynamic_cast<ie::capped_pool_resource<std::byte>*>(&_resource); cpr) {
+        return from_pool(cpr);
+    }
+
+    if (const auto* cpr = dynamic_cast<ie::capped_pool_resource<std::byte, pmr::synchronized_pool_resource>*>(&_resource); cpr) {
+        return from_pool(cpr);
+    }
+
+    return {};
+}
+
+auto make_cases(std::byte* _buffer, std::size_t _buffer_size, const pmr::pool_options& _tuned) -> std::vector<benchmark_case>
+{
+    const auto size = static_cast<std::int64_t>(_buffer_size);
+
+    const auto fbr_case = [_buffer, size](ie::allocation_strategy _strategy) -> stack_factory {
+        return [_buffer, size, _strategy](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, _strategy};
+            _run(fbr);
+        };
+    };
+
+    return {
+        {"new_delete_resource", [](const auto& _run) {
+            _run(*pmr::new_delete_resource());
+        }},
+        {"capped_memory_pool", [size](const auto& _run) {
+            bench::capped_memory_pool cmp{size};
+            _run(cmp);
+        }},
+        {"fixed_buffer_resource(first_fit)", fbr_case(ie::allocation_strategy::first_fit)},
+        {"fixed_buffer_resource(segregated_fit)", fbr_case(ie::allocation_strategy::segregated_fit)},
+        {"fixed_buffer_resource(two_level_segregated_fit)", fbr_case(ie::allocation_strategy::two_level_segregated_fit)},
+        {"buddy_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::buddy_buffer_resource bbr{_buffer, size};
+            _run(bbr);
+        }},
+        {"unsynchronized_pool_resource/fixed_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size};
+            pmr::unsynchronized_pool_resource upr{&fbr};
+            _run(upr);
+        }},
+        {"slab_resource/fixed_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size};
+            ie::slab_resource sr{&fbr};
+            _run(sr);
+        }},
+        {"capped_pool_resource(default options)", [_buffer, size](const auto& _run) {
+            ie::capped_pool_resource<std::byte> cpr{_buffer, size};
+            _run(cpr);
+        }},
+        {"capped_pool_resource(tuned options)", [_buffer, size, _tuned](const auto& _run) {
+            ie::capped_pool_resource<std::byte> cpr{_buffer, size, _tuned};
+            _run(cpr);
+        }},
+        {"capped_pool_resource<synchronized>(tuned options)", [_buffer, size, _tuned](const auto& _run) {
+            ie::capped_pool_resource<std::byte, pmr::synchronized_pool_resource> cpr{_buffer, size, _tuned};
+            _run(cpr);
+        }},
+        {"unsynchronized_pool_resource/capped_memory_pool", [size](const auto& _run) {
+            bench::capped_memory_pool cmp{size};
+            pmr::unsynchronized_pool_resource upr{&cmp};
+            _run(upr);
+        }},
+    };
+}
+
+int main(int _argc, char** _argv)
+{
+    try {
+        const auto opts = parse_options(_argc, _argv);
+
+        // A vector is zero-filled up front, so page faults are not part of the first
+        // measurement of the buffer-based resources. A mapped buffer is committed on first
+        // touch, which the warmup runs take care of.
+        std::vector<std::byte> vector_buffer;
+        std::optional<ie::mapped_buffer> mapped_buffer;
+        std::byte* buffer = nullptr;
+
+        if (opts.buffer == "vector") {
+            vector_buffer.resize(opts.max_size);
+            buffer = vector_buffer.data();
+        }
+        else {
+            const auto pages = opts.buffer == "hugetlb" ? ie::page_policy::huge_pages
+                             : opts.buffer == "thp"     ? ie::page_policy::transparent_huge_pages
+                                                        : ie::page_policy::default_pages;
+            buffer = mapped_buffer.emplace(opts.max_size, pages).data();
+        }
+
+        std::mt19937 gen{opts.seed};
+        bench::report report;
+
+        for (const auto length : opts.lengths) {
+            const auto inputs = generate_strings(opts.strings, length, gen);
+            const auto tuned = tune_for(inputs);
+
+            for (const auto& c : make_cases(buffer, opts.max_size, tuned)) {
+                if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) {
+                    continue;
+                }
+
+                std::vector<double> samples;
+                std::string error;
+                std::optional<std::size_t> buffer_in_use;
+                std::optional<double> hit_rate;
+
+                for (std::size_t i = 0; i < opts.warmup + opts.repetitions && error.empty(); ++i) {
+                    try {
+                        c.make_stack([&](pmr::memory_resource& _resource) {
+                            const auto ms = run_once(_resource, inputs, [&] {
+                                std::tie(buffer_in_use, hit_rate) = inspect(_resource);
+                            });
+
+                            if (i >= opts.warmup) {
+                                samples.push_back(ms);
+                            }
+                        });
+                    }
+                    catch (const std::bad_alloc&) {
+                        error = "bad_alloc";
+                    }
+                }
+
+                const auto s = bench::summarize(samples);
+
+                report.add({bench::text("resource", c.name),
+                            bench::number("string_length", length),
+                            bench::number("strings", opts.strings),
+                            bench::number("repetitions", s.samples),
+                            bench::number("min_ms", s.min),
+                            bench::number("median_ms", s.p50),
+                            bench::number("p90_ms", s.p90),
+                            bench::number("max_ms", s.max),
+                            bench::number("mean_ms", s.mean),
+                            bench::number("median_ns_per_string", s.p50 * 1e6 / opts.strings),
+                            buffer_in_use ? bench::number("buffer_in_use", *buffer_in_use) : bench::text("buffer_in_use", "-"),
+                            hit_rate ? bench::number("pool_hit_rate", *hit_rate) : bench::text("pool_hit_rate", "-"),
+                            bench::text("error", error.empty() ? "-" : error)});
+            }
+        }
+
+        report.write(std::cout, opts.format);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,360 @@
+// Replays an allocation trace written by tracing_resource against several memory resource
+// stacks.
+//
+// Usage: alloc_replay --trace FILE [--record N] [--warmup N] [--repetitions N]
+//                     [--max-size BYTES] [--seed N] [--filter SUBSTRING]
+//                     [--format table|csv|json]
+//
+// A trace is captured by wrapping the resource of a real workload in a tracing_resource.
+// --record N writes a synthetic trace of N operations to FILE first: strings of random lengths
+// with random lifetimes, released in bulk now and then like the objects of a request.
+//
+// The trace is decoded before any timing starts. Each repetition builds a fresh resource stack
+// and times the loop that performs every allocation and deallocation of the trace, in order.
+// Allocations that fail are counted, and their deallocations are skipped. Allocations the
+// trace never frees are released after the timed loop.
+//
+// peak_in_use is the largest amount of memory the stack drew from its buffer (or from malloc
+// for capped_memory_pool) during an extra, untimed run.
+
+#include "benchmark_support.hpp"
+#include "buddy_buffer_resource.hpp"
+#include "capped_pool_resource.hpp"
+#include "fixed_buffer_resource.hpp"
+#include "slab_resource.hpp"
+#include "tracing_resource.hpp"
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/string.hpp>
+#include <boost/container/pmr/unsynchronized_pool_resource.hpp>
+#include <boost/container/pmr/vector.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+namespace bench = irods::experimental::pmr::bench;
+
+struct options
+{
+    std::string trace;
+    std::size_t record = 0;
+    std::size_t warmup = 1;
+    std::size_t repetitions = 5;
+    std::size_t max_size = 50'000'000;
+    std::uint32_t seed = 1;
+    std::string filter;
+    bench::output_format format = bench::output_format::table;
+};
+
+// Returns the number of bytes the stack currently draws from its buffer.
+using usage_probe = std::function<std::size_t()>;
+
+// Constructs a resource stack, hands the top of the stack (and a probe, if the stack has one)
+// to the callback and tears the stack down again. Construction and destruction are not timed.
+using stack_factory = std::function<void(const std::function<void(pmr::memory_resource&, const usage_probe&)>&)>;
+
+struct benchmark_case
+{
+    std::string name;
+    stack_factory make_stack;
+};
+
+struct replay_result
+{
+    double ms;
+    std::size_t failed_allocations;
+    std::size_t peak_in_use;
+};
+
+auto parse_options(int _argc, char** _argv) -> options
+{
+    options opts;
+
+    for (int i = 1; i < _argc; ++i) {
+        const std::string_view arg = _argv[i];
+
+        if (i + 1 >= _argc) {
+            throw std::invalid_argument{fmt::format("missing value for option [{}]", arg)};
+        }
+
+        const std::string value = _argv[++i];
+
+        if      (arg == "--trace")       { opts.trace = value; }
+        else if (arg == "--record")      { opts.record = std::stoul(value); }
+        else if (arg == "--warmup")      { opts.warmup = std::stoul(value); }
+        else if (arg == "--repetitions") { opts.repetitions = std::stoul(value); }
+        else if (arg == "--max-size")    { opts.max_size = std::stoul(value); }
+        else if (arg == "--seed")        { opts.seed = static_cast<std::uint32_t>(std::stoul(value)); }
+        else if (arg == "--filter")      { opts.filter = value; }
+        else if (arg == "--format")      { opts.format = bench::to_output_format(value); }
+        else {
+            throw std::invalid_argument{fmt::format("unknown option [{}]", arg)};
+        }
+    }
+
+    if (opts.trace.empty()) {
+        throw std::invalid_argument{"--trace is required"};
+    }
+
+    if (opts.repetitions == 0) {
+        throw std::invalid_argument{"--repetitions must be greater than zero"};
+    }
+
+    return opts;
+}
+
+// Writes a trace of roughly "_operations" allocations and deallocations made by a workload of
+// pmr::string objects with random lengths and lifetimes.
+auto record_synthetic_trace(const std::string& _path, std::size_t _operations, std::uint32_t _seed) -> void
+{
+    std::ofstream out{_path, std::ios::binary | std::ios::trunc};
+
+    if (!out) {
+        throw std::runtime_error{fmt::format("could not open [{}] for writing", _path)};
+    }
+
+    std::mt19937 gen{_seed};
+    std::uniform_real_distribution<double> log_length{0.0, 10.0};
+    std::uniform_int_distribution<int> percent{0, 99};
+
+    ie::tracing_resource tracer{pmr::new_delete_resource(), out};
+
+    {
+        pmr::vector<pmr::string> live{&tracer};
+
+        while (tracer.records() < _operations) {
+            const auto roll = percent(gen);
+
+            if (roll == 0) {
+                // The end of a request releases everything it allocated.
+                live.clear();
+                live.shrink_to_fit();
+            }
+            else if (roll < 60 || live.empty()) {
+                const auto length = static_cast<std::size_t>(std::exp2(log_length(gen)));
+                live.emplace_back(length, 'x');
+            }
+            else {
+                std::uniform_int_distribution<std::size_t> pick{0, live.size() - 1};
+                std::swap(live[pick(gen)], live.back());
+                live.pop_back();
+            }
+        }
+    }
+
+    tracer.flush();
+}
+
+auto load_trace(const std::string& _path) -> std::vector<ie::trace_record>
+{
+    std::ifstream in{_path, std::ios::binary};
+
+    if (!in) {
+        throw std::runtime_error{fmt::format("could not open [{}] for reading", _path)};
+    }
+
+    return ie::read_trace(in);
+}
+
+// Performs every operation of the trace against the resource. "_slots" maps allocation ids to
+// addresses and must have room for the largest id. If "_probe" is set, it is called after every
+// allocation and the largest value is reported.
+auto replay_once(pmr::memory_resource& _resource,
+                 const std::vector<ie::trace_record>& _trace,
+                 std::vector<void*>& _slots,
+                 const usage_probe& _probe = {}) -> replay_result
+{
+    std::fill(std::begin(_slots), std::end(_slots), nullptr);
+
+    replay_result result{};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& r : _trace) {
+        if (r.operation == ie::trace_operation::allocate) {
+            try {
+                _slots[r.id] = _resource.allocate(r.bytes, r.alignment);
+            }
+            catch (const std::bad_alloc&) {
+                ++result.failed_allocations;
+                continue;
+            }
+
+            if (_probe) {
+                result.peak_in_use = std::max(result.peak_in_use, _probe());
+            }
+        }
+        else if (auto*& p = _slots[r.id]; p) {
+            _resource.deallocate(p, r.bytes, r.alignment);
+            p = nullptr;
+        }
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // The sizes of leftover allocations are in their allocation records.
+    for (const auto& r : _trace) {
+        if (r.operation == ie::trace_operation::allocate && _slots[r.id]) {
+            _resource.deallocate(_slots[r.id], r.bytes, r.alignment);
+            _slots[r.id] = nullptr;
+        }
+    }
+
+    result.ms = std::chrono::duration<double, std::milli>(elapsed).count();
+
+    return result;
+}
+
+auto make_cases(std::byte* _buffer, std::size_t _buffer_size) -> std::vector<benchmark_case>
+{
+    const auto size = static_cast<std::int64_t>(_buffer_size);
+
+    const auto fbr_case = [_buffer, size](ie::allocation_strategy _strategy) -> stack_factory {
+        return [_buffer, size, _strategy](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, _strategy};
+            _run(fbr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        };
+    };
+
+    return {
+        {"new_delete_resource", [](const auto& _run) {
+            _run(*pmr::new_delete_resource(), usage_probe{});
+        }},
+        {"capped_memory_pool", [size](const auto& _run) {
+            bench::capped_memory_pool cmp{size};
+            _run(cmp, [&cmp] { return cmp.allocated(); });
+        }},
+        {"fixed_buffer_resource(first_fit)", fbr_case(ie::allocation_strategy::first_fit)},
+        {"fixed_buffer_resource(segregated_fit)", fbr_case(ie::allocation_strategy::segregated_fit)},
+        {"fixed_buffer_resource(two_level_segregated_fit)", fbr_case(ie::allocation_strategy::two_level_segregated_fit)},
+        {"buddy_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::buddy_buffer_resource bbr{_buffer, size};
+            _run(bbr, [&bbr] { return bbr.allocated() + bbr.allocation_overhead(); });
+        }},
+        {"unsynchronized_pool_resource/fixed_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size};
+            pmr::unsynchronized_pool_resource upr{&fbr};
+            _run(upr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        }},
+        {"slab_resource/fixed_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size};
+            ie::slab_resource sr{&fbr};
+            _run(sr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        }},
+        {"capped_pool_resource", [_buffer, size](const auto& _run) {
+            ie::capped_pool_resource<std::byte> cpr{_buffer, size};
+            _run(cpr, [&cpr] { return cpr.statistics().buffer_in_use; });
+        }},
+        {"unsynchronized_pool_resource/capped_memory_pool", [size](const auto& _run) {
+            bench::capped_memory_pool cmp{size};
+            pmr::unsynchronized_pool_resource upr{&cmp};
+            _run(upr, [&cmp] { return cmp.allocated(); });
+        }},
+    };
+}
+
+int main(int _argc, char** _argv)
+{
+    try {
+        const auto opts = parse_options(_argc, _argv);
+
+        if (opts.record > 0) {
+            record_synthetic_trace(opts.trace, opts.record, opts.seed);
+        }
+
+        const auto trace = load_trace(opts.trace);
+
+        std::uint64_t max_id = 0;
+        std::size_t live_bytes = 0;
+        std::size_t peak_live_bytes = 0;
+
+        for (const auto& r : trace) {
+            max_id = std::max(max_id, r.id);
+
+            if (r.operation == ie::trace_operation::allocate) {
+                peak_live_bytes = std::max(peak_live_bytes, live_bytes += r.bytes);
+            }
+            else {
+                live_bytes -= r.bytes;
+            }
+        }
+
+        std::cerr << fmt::format("trace: {} operations, {} allocations, {} bytes live at peak, {:.3f} ms recorded\n",
+                                 trace.size(),
+                                 max_id,
+                                 peak_live_bytes,
+                                 trace.empty() ? 0.0 : trace.back().timestamp / 1e6);
+
+        std::vector<std::byte> buffer(opts.max_size);
+        std::vector<void*> slots(max_id + 1);
+        bench::report report;
+
+        for (const auto& c : make_cases(buffer.data(), opts.max_size)) {
+            if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) {
+                continue;
+            }
+
+            std::vector<double> samples;
+            std::size_t failed_allocations = 0;
+            std::optional<std::size_t> peak_in_use;
+
+            for (std::size_t i = 0; i < opts.warmup + opts.repetitions; ++i) {
+                c.make_stack([&](pmr::memory_resource& _resource, const usage_probe&) {
+                    const auto result = replay_once(_resource, trace, slots);
+
+                    if (i >= opts.warmup) {
+                        samples.push_back(result.ms);
+                        failed_allocations = result.failed_allocations;
+                    }
+                });
+            }
+
+            c.make_stack([&](pmr::memory_resource& _resource, const usage_probe& _probe) {
+                if (_probe) {
+                    peak_in_use = replay_once(_resource, trace, slots, _probe).peak_in_use;
+                }
+            });
+
+            const auto s = bench::summarize(samples);
+
+            report.add({bench::text("resource", c.name),
+                        bench::number("operations", trace.size()),
+                        bench::number("repetitions", s.samples),
+                        bench::number("min_ms", s.min),
+                        bench::number("median_ms", s.p50),
+                        bench::number("p90_ms", s.p90),
+                        bench::number("max_ms", s.max),
+                        bench::number("mean_ms", s.mean),
+                        bench::number("median_ns_per_operation", trace.empty() ? 0.0 : s.p50 * 1e6 / trace.size()),
+                        peak_in_use ? bench::number("peak_in_use", *peak_in_use) : bench::text("peak_in_use", "-"),
+                        bench::number("failed_allocations", failed_allocations)});
+        }
+
+        report.write(std::cout, opts.format);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,304 @@
+#ifndef IRODS_BENCHMARK_SUPPORT_HPP
+#define IRODS_BENCHMARK_SUPPORT_HPP
+
+/// \file
+///
+/// Helpers shared by the benchmark drivers. Not meant to be used by library code.
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace irods::experimental::pmr::bench
+{
+    /// The same capped resource the drivers have always used: malloc/free plus a byte counter.
+    /// Kept here so that every benchmark measures the identical implementation.
+    class capped_memory_pool
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        explicit capped_memory_pool(std::int64_t _max_size)
+            : boost::container::pmr::memory_resource{}
+            , max_size_(_max_size)
+            , allocated_{}
+        {
+            if (_max_size <= 0) {
+                throw std::invalid_argument{"capped_memory_pool: invalid value for max size"};
+            }
+        }
+
+        auto allocated() const noexcept -> std::size_t
+        {
+            return allocated_;
+        }
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t) -> void* override
+        {
+            if (allocated_ + _bytes >= max_size_) {
+                throw std::bad_alloc{};
+            }
+
+            if (auto* p = std::malloc(_bytes); p) {
+                allocated_ += _bytes;
+                return p;
+            }
+
+            throw std::bad_alloc{};
+        }
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t) -> void override
+        {
+            std::free(_p);
+            allocated_ -= _bytes;
+        }
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        }
+
+    private:
+        std::size_t max_size_;
+        std::size_t allocated_;
+    }; // class capped_memory_pool
+
+    /// Order statistics over a set of samples.
+    struct summary
+    {
+        std::size_t samples;
+        double min;
+        double mean;
+        double p50;
+        double p90;
+        double p99;
+        double max;
+    }; // struct summary
+
+    /// Returns the nearest-rank percentile \p _p (0-100) of the sorted samples.
+    inline auto percentile(const std::vector<double>& _sorted, double _p) -> double
+    {
+        if (_sorted.empty()) {
+            return 0;
+        }
+
+        const auto rank = static_cast<std::size_t>(std::ceil(_p / 100.0 * _sorted.size()));
+        return _sorted[std::clamp<std::size_t>(rank, 1, _sorted.size()) - 1];
+    } // percentile
+
+    inline auto summarize(std::vector<double> _samples) -> summary
+    {
+        if (_samples.empty()) {
+            return {};
+        }
+
+        std::sort(std::begin(_samples), std::end(_samples));
+
+        const auto sum = std::accumulate(std::begin(_samples), std::end(_samples), 0.0);
+
+        return {_samples.size(),
+                _samples.front(),
+                sum / _samples.size(),
+                percentile(_samples, 50),
+                percentile(_samples, 90),
+                percentile(_samples, 99),
+                _samples.back()};
+    } // summarize
+
+    enum class output_format
+    {
+        table,
+        csv,
+        json
+    }; // enum class output_format
+
+    inline auto to_output_format(std::string_view _name) -> output_format
+    {
+        if (_name == "table") { return output_format::table; }
+        if (_name == "csv")   { return output_format::csv; }
+        if (_name == "json")  { return output_format::json; }
+
+        throw std::invalid_argument{fmt::format("unknown output format [{}]", _name)};
+    } // to_output_format
+
+    /// A single named value in a row of results.
+    struct field
+    {
+        std::string name;
+        std::string value;
+        bool numeric;
+    }; // struct field
+
+    inline auto text(std::string _name, std::string _value) -> field
+    {
+        return {std::move(_name), std::move(_value), false};
+    } // text
+
+    template <typename T>
+    auto number(std::string _name, T _value) -> field
+    {
+        if constexpr (std::is_floating_point_v<T>) {
+            return {std::move(_name), fmt::format("{:.3f}", _value), true};
+        }
+        else {
+            return {std::move(_name), fmt::format("{}", _value), true};
+        }
+    } // number
+
+    /// Returns \p _value as a quoted CSV field. Embedded quotes are doubled (RFC 4180).
+    inline auto csv_quote(std::string_view _value) -> std::string
+    {
+        std::string quoted{'"'};
+
+        for (const auto c : _value) {
+            if (c == '"') {
+                quoted += '"';
+            }
+
+            quoted += c;
+        }
+
+        quoted += '"';
+
+        return quoted;
+    } // csv_quote
+
+    /// Returns \p _value as a JSON string literal, including the surrounding quotes.
+    inline auto json_quote(std::string_view _value) -> std::string
+    {
+        std::string quoted{'"'};
+
+        for (const auto c : _value) {
+            switch (c) {
+                case '"':  quoted += "\\\""; break;
+                case '\\': quoted += "\\\\"; break;
+                case '\n': quoted += "\\n"; break;
+                case '\r': quoted += "\\r"; break;
+                case '\t': quoted += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        quoted += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+                    }
+                    else {
+                        quoted += c;
+                    }
+                    break;
+            }
+        }
+
+        quoted += '"';
+
+        return quoted;
+    } // json_quote
+
+    /// Collects rows of results and writes them as an aligned table, CSV or a JSON array of
+    /// objects. Every row is expected to have the same fields in the same order.
+    class report
+    {
+    public:
+        auto add(std::vector<field> _row) -> void
+        {
+            rows_.push_back(std::move(_row));
+        }
+
+        auto write(std::ostream& _os, output_format _format) const -> void
+        {
+            if (rows_.empty()) {
+                return;
+            }
+
+            switch (_format) {
+                case output_format::table: write_table(_os); break;
+                case output_format::csv:   write_csv(_os); break;
+                case output_format::json:  write_json(_os); break;
+            }
+        }
+
+    private:
+        auto write_table(std::ostream& _os) const -> void
+        {
+            const auto& first = rows_.front();
+            std::vector<std::size_t> widths(first.size());
+
+            for (std::size_t i = 0; i < first.size(); ++i) {
+                widths[i] = first[i].name.size();
+
+                for (const auto& row : rows_) {
+                    widths[i] = std::max(widths[i], row[i].value.size());
+                }
+            }
+
+            for (std::size_t i = 0; i < first.size(); ++i) {
+                _os << fmt::format("{:<{}}  ", first[i].name, widths[i]);
+            }
+            _os << '\n';
+
+            for (const auto& row : rows_) {
+                for (std::size_t i = 0; i < row.size(); ++i) {
+                    if (row[i].numeric) {
+                        _os << fmt::format("{:>{}}  ", row[i].value, widths[i]);
+                    }
+                    else {
+                        _os << fmt::format("{:<{}}  ", row[i].value, widths[i]);
+                    }
+                }
+                _os << '\n';
+            }
+        }
+
+        auto write_csv(std::ostream& _os) const -> void
+        {
+            const auto& first = rows_.front();
+
+            for (std::size_t i = 0; i < first.size(); ++i) {
+                _os << (i ? "," : "") << csv_quote(first[i].name);
+            }
+            _os << '\n';
+
+            for (const auto& row : rows_) {
+                for (std::size_t i = 0; i < row.size(); ++i) {
+                    _os << (i ? "," : "") << (row[i].numeric ? row[i].value : csv_quote(row[i].value));
+                }
+                _os << '\n';
+            }
+        }
+
+        auto write_json(std::ostream& _os) const -> void
+        {
+            _os << "[\n";
+
+            for (std::size_t r = 0; r < rows_.size(); ++r) {
+                _os << "  {";
+
+                for (std::size_t i = 0; i < rows_[r].size(); ++i) {
+                    const auto& f = rows_[r][i];
+                    _os << (i ? ", " : "") << json_quote(f.name) << ": "
+                        << (f.numeric ? f.value : json_quote(f.value));
+                }
+
+                _os << (r + 1 < rows_.size() ? "},\n" : "}\n");
+            }
+
+            _os << "]\n";
+        }
+
+        std::vector<std::vector<field>> rows_;
+    }; // class report
+} // namespace irods::experimental::pmr::bench
+
+#endif // IRODS_BENCHMARK_SUPPORT_HPP
@@ -0,0 +1,410 @@
+#ifndef IRODS_BUDDY_BUFFER_RESOURCE_HPP
+#define IRODS_BUDDY_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+namespace irods::experimental::pmr
+{
+    /// A \p buddy_buffer_resource is a special purpose memory resource class template that
+    /// allocates memory from the buffer given on construction using a binary buddy system.
+    /// Like \p fixed_buffer_resource, it allows applications to enforce a cap on the amount of
+    /// memory available to components.
+    ///
+    /// Every allocation is rounded up to a power-of-two multiple of \p min_block_size. Blocks
+    /// are split in half until they match the request and are merged with their buddy when
+    /// released, so both operations run in O(log n) and never visit other allocations.
+    /// Allocations do not carry a header. The state of every block is tracked in bitmaps that
+    /// are stored at the front of the buffer, so the metadata counts against the cap too.
+    ///
+    /// This works best for requests that are already powers of two (e.g. the growth buffers
+    /// of \p pmr::vector). This class is NOT thread-safe.
+    ///
+    /// \tparam ByteRep The memory representation for the underlying buffer. Must be one of
+    ///                 the following:
+    /// - char
+    /// - unsigned char
+    /// - std::byte
+    ///
+    /// \since 4.2.11
+    template <typename ByteRep>
+    class buddy_buffer_resource
+        : public boost::container::pmr::memory_resource
+    {
+    private:
+        // Unused blocks are linked into the free list of their order. The links are stored
+        // in the unused memory.
+        struct free_block
+        {
+            free_block* prev;
+            free_block* next;
+        }; // struct free_block
+
+    public:
+        static_assert(std::is_same_v<ByteRep, char> ||
+                      std::is_same_v<ByteRep, unsigned char> ||
+                      std::is_same_v<ByteRep, std::byte>);
+
+        /// The size of the smallest block (order 0) in bytes.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t min_block_size = std::max(sizeof(free_block), alignof(std::max_align_t));
+
+        /// The largest alignment supported by the resource.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t max_alignment = 4096;
+
+        /// Constructs a \p buddy_buffer_resource using the given buffer as the allocation
+        /// source.
+        ///
+        /// \param[in] _buffer      The buffer that will be used for allocations.
+        /// \param[in] _buffer_size The size of the buffer in bytes.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        buddy_buffer_resource(ByteRep* _buffer, std::int64_t _buffer_size)
+            : boost::container::pmr::memory_resource{}
+            , buffer_{_buffer}
+            , buffer_size_(_buffer_size)
+            , arena_{}
+            , arena_size_{}
+            , max_order_{}
+            , allocated_{}
+            , reserved_{}
+            , bitmaps_{}
+            , bitmap_offsets_{}
+            , free_lists_{}
+            , non_empty_orders_{}
+        {
+            if (!_buffer || _buffer_size <= 0) {
+                const auto* msg_fmt = "buddy_buffer_resource: invalid constructor arguments "
+                                      "[buffer={}, size={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, fmt::ptr(_buffer), _buffer_size)};
+            }
+
+            // Size the bitmaps for the largest arena the buffer could hold. Order "k" needs one
+            // bit per block of size "min_block_size << k".
+            const auto max_blocks = buffer_size_ / min_block_size;
+            std::size_t words = 0;
+
+            for (std::size_t k = 0; (max_blocks >> k) > 0; ++k) {
+                bitmap_offsets_[k] = words;
+                words += ((max_blocks >> k) + bits_per_word - 1) / bits_per_word;
+                max_order_ = k;
+            }
+
+            void* p = buffer_;
+            std::size_t space_left = buffer_size_;
+
+            if (!std::align(alignof(std::size_t), words * sizeof(std::size_t), p, space_left)) {
+                throw std::invalid_argument{"buddy_buffer_resource: buffer is too small."};
+            }
+
+            bitmaps_ = static_cast<std::size_t*>(p);
+            std::uninitialized_value_construct_n(bitmaps_, words);
+
+            p = static_cast<ByteRep*>(p) + words * sizeof(std::size_t);
+            space_left -= words * sizeof(std::size_t);
+
+            if (!std::align(max_alignment, min_block_size, p, space_left)) {
+                throw std::invalid_argument{"buddy_buffer_resource: buffer is too small."};
+            }
+
+            arena_ = static_cast<ByteRep*>(p);
+            arena_size_ = space_left - space_left % min_block_size;
+
+            // Carve the arena into the largest naturally aligned blocks possible. A buddy that
+            // would extend past the end of the arena is never marked unused, so those blocks
+            // are never merged.
+            for (std::size_t offset = 0; offset < arena_size_;) {
+                auto k = max_order_;
+
+                while (offset % block_size(k) != 0 || offset + block_size(k) > arena_size_) {
+                    --k;
+                }
+
+                push_free_block(offset, k);
+                offset += block_size(k);
+            }
+        } // buddy_buffer_resource
+
+        buddy_buffer_resource(const buddy_buffer_resource&) = delete;
+        auto operator=(const buddy_buffer_resource&) -> buddy_buffer_resource& = delete;
+
+        ~buddy_buffer_resource() = default;
+
+        /// Returns the number of bytes used by the client.
+        ///
+        /// The value returned does not include memory used for tracking allocations or memory
+        /// lost to rounding requests up to a block size.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto allocated() const noexcept -> std::size_t
+        {
+            return allocated_;
+        } // allocated
+
+        /// Returns the number of bytes of the buffer that are not available to the client.
+        ///
+        /// This includes the bitmaps, the bytes lost to aligning the arena, and the bytes lost
+        /// to rounding allocations up to a power-of-two block size.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto allocation_overhead() const noexcept -> std::size_t
+        {
+            return (buffer_size_ - arena_size_) + (reserved_ - allocated_);
+        } // allocation_overhead
+
+        /// Returns the order of the largest block a buffer of this size could hold. The arena
+        /// may be too small for a block of that order.
+        ///
+        /// \since 4.2.11
+        auto max_order() const noexcept -> std::size_t
+        {
+            return max_order_;
+        } // max_order
+
+        /// Returns the number of unused blocks of order \p _order, whose size is
+        /// \p min_block_size << \p _order bytes.
+        ///
+        /// \since 4.2.11
+        auto free_block_count(std::size_t _order) const noexcept -> std::size_t
+        {
+            if (_order > max_order_) {
+                return 0;
+            }
+
+            std::size_t count = 0;
+
+            for (auto* b = free_lists_[_order]; b; b = b->next) {
+                ++count;
+            }
+
+            return count;
+        } // free_block_count
+
+        /// Writes the state of the free lists to the output stream.
+        ///
+        /// \since 4.2.11
+        auto print(std::ostream& _os) const -> void
+        {
+            _os << fmt::format("Arena Info [{}]: {{size={}, max_order={}, allocated={}, overhead={}}}\n",
+                               fmt::ptr(arena_),
+                               arena_size_,
+                               max_order_,
+                               allocated_,
+                               allocation_overhead());
+
+            for (std::size_t k = 0; k <= max_order_; ++k) {
+                if (const auto count = free_block_count(k); count > 0) {
+                    _os << fmt::format("{:>3}. Order Info: {{block_size={}, free_blocks={}, head={}}}\n",
+                                       k,
+                                       block_size(k),
+                                       count,
+                                       fmt::ptr(free_lists_[k]));
+                }
+            }
+        } // print
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            if (_alignment > max_alignment) {
+                throw std::bad_alloc{};
+            }
+
+            const auto k = order_of(std::max(_bytes, _alignment));
+
+            if (k > max_order_) {
+                throw std::bad_alloc{};
+            }
+
+            const auto candidates = non_empty_orders_ & (~std::size_t{0} << k);
+
+            if (!candidates) {
+                throw std::bad_alloc{};
+            }
+
+            auto j = lowest_bit_index(candidates);
+            const auto offset = pop_free_block(j);
+
+            // Split the block until it matches the requested order. The upper half is always
+            // the one returned to the free lists.
+            while (j > k) {
+                --j;
+                push_free_block(offset + block_size(j), j);
+            }
+
+            allocated_ += _bytes;
+            reserved_ += block_size(k);
+
+            return arena_ + offset;
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            assert(_p >= arena_ && static_cast<ByteRep*>(_p) < arena_ + arena_size_);
+
+            auto k = order_of(std::max(_bytes, _alignment));
+            auto offset = static_cast<std::size_t>(static_cast<ByteRep*>(_p) - arena_);
+
+            assert(offset % block_size(k) == 0);
+
+            allocated_ -= _bytes;
+            reserved_ -= block_size(k);
+
+            // Merge with the buddy for as long as the buddy is unused.
+            for (; k < max_order_; ++k) {
+                const auto buddy = offset ^ block_size(k);
+
+                if (buddy + block_size(k) > arena_size_ || !is_free(buddy, k)) {
+                    break;
+                }
+
+                remove_free_block(buddy, k);
+                offset = std::min(offset, buddy);
+            }
+
+            push_free_block(offset, k);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        static constexpr std::size_t bits_per_word = sizeof(std::size_t) * CHAR_BIT;
+
+        static constexpr auto block_size(std::size_t _order) noexcept -> std::size_t
+        {
+            return min_block_size << _order;
+        } // block_size
+
+        static auto lowest_bit_index(std::size_t _bits) noexcept -> std::size_t
+        {
+            assert(_bits != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_ctzll(_bits));
+#else
+            std::size_t i = 0;
+            while ((_bits & 1) == 0) {
+                _bits >>= 1;
+                ++i;
+            }
+            return i;
+#endif
+        } // lowest_bit_index
+
+        // Returns the smallest order whose block size is at least "_bytes".
+        static auto order_of(std::size_t _bytes) noexcept -> std::size_t
+        {
+            std::size_t k = 0;
+
+            while (block_size(k) < _bytes && k < bits_per_word - 1) {
+                ++k;
+            }
+
+            return k;
+        } // order_of
+
+        auto bit_of(std::size_t _offset, std::size_t _order) const noexcept -> std::tuple<std::size_t&, std::size_t>
+        {
+            const auto i = _offset / block_size(_order);
+            return {bitmaps_[bitmap_offsets_[_order] + i / bits_per_word], std::size_t{1} << (i % bits_per_word)};
+        } // bit_of
+
+        auto is_free(std::size_t _offset, std::size_t _order) const noexcept -> bool
+        {
+            const auto [word, mask] = bit_of(_offset, _order);
+            return (word & mask) != 0;
+        } // is_free
+
+        auto push_free_block(std::size_t _offset, std::size_t _order) noexcept -> void
+        {
+            auto* b = new (arena_ + _offset) free_block;
+            b->prev = nullptr;
+            b->next = free_lists_[_order];
+
+            if (b->next) {
+                b->next->prev = b;
+            }
+
+            free_lists_[_order] = b;
+            non_empty_orders_ |= std::size_t{1} << _order;
+
+            auto [word, mask] = bit_of(_offset, _order);
+            word |= mask;
+        } // push_free_block
+
+        auto remove_free_block(std::size_t _offset, std::size_t _order) noexcept -> void
+        {
+            auto* b = reinterpret_cast<free_block*>(arena_ + _offset);
+
+            if (b->prev) {
+                b->prev->next = b->next;
+            }
+            else {
+                free_lists_[_order] = b->next;
+            }
+
+            if (b->next) {
+                b->next->prev = b->prev;
+            }
+
+            if (!free_lists_[_order]) {
+                non_empty_orders_ &= ~(std::size_t{1} << _order);
+            }
+
+            auto [word, mask] = bit_of(_offset, _order);
+            word &= ~mask;
+        } // remove_free_block
+
+        auto pop_free_block(std::size_t _order) noexcept -> std::size_t
+        {
+            assert(free_lists_[_order]);
+
+            const auto offset = static_cast<std::size_t>(reinterpret_cast<ByteRep*>(free_lists_[_order]) - arena_);
+            remove_free_block(offset, _order);
+
+            return offset;
+        } // pop_free_block
+
+        ByteRep* buffer_;
+        std::size_t buffer_size_;
+        ByteRep* arena_;            // The naturally aligned region blocks are carved from.
+        std::size_t arena_size_;
+        std::size_t max_order_;
+        std::size_t allocated_;     // Bytes requested by the client.
+        std::size_t reserved_;      // Bytes of the blocks handed to the client.
+        std::size_t* bitmaps_;      // Bit "i" of order "k" is set if block "i" of that order is unused.
+        std::array<std::size_t, bits_per_word> bitmap_offsets_;
+        std::array<free_block*, bits_per_word> free_lists_;
+        std::size_t non_empty_orders_;
+    }; // buddy_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_BUDDY_BUFFER_RESOURCE_HPP
@@ -0,0 +1,192 @@
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "buddy_buffer_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    using resource_type = ie::buddy_buffer_resource<std::byte>;
+
+    constexpr auto min_block_size = resource_type::min_block_size;
+
+    constexpr auto block_size_of(std::size_t _order) -> std::size_t
+    {
+        return min_block_size << _order;
+    }
+
+    // Large enough for a block of 1 MiB after the bitmaps and the alignment of the arena.
+    constexpr std::size_t buffer_size = 1024 * 1024 + 64 * 1024;
+
+    // Returns the number of unused blocks of every order.
+    auto free_blocks(const resource_type& _resource) -> std::vector<std::size_t>
+    {
+        std::vector<std::size_t> counts;
+
+        for (std::size_t k = 0; k <= _resource.max_order(); ++k) {
+            counts.push_back(_resource.free_block_count(k));
+        }
+
+        return counts;
+    }
+
+    // Returns the order of the largest unused block.
+    auto top_order(const std::vector<std::size_t>& _free_blocks) -> std::size_t
+    {
+        auto k = _free_blocks.size() - 1;
+
+        while (k > 0 && _free_blocks[k] == 0) {
+            --k;
+        }
+
+        return k;
+    }
+
+    auto test_split_and_merge() -> void
+    {
+        std::vector<std::byte> buffer(buffer_size);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        const auto initial = free_blocks(resource);
+        const auto top = top_order(initial);
+
+        check(block_size_of(top) >= 1024 * 1024, "the arena holds a block of 1 MiB");
+        check(initial[top] == 1, "the arena starts with a single top-order block");
+
+        // The blocks behind the top-order block are smaller than 64 KiB, so a request of
+        // that size has to split the top-order block. Every split leaves the upper half
+        // unused.
+        const auto order = top - 4;
+        const auto size = block_size_of(order);
+
+        for (auto k = order; k < top; ++k) {
+            check(initial[k] == 0, "no other block can serve the request");
+        }
+
+        auto* a = static_cast<std::byte*>(resource.allocate(size));
+        auto counts = free_blocks(resource);
+
+        check(counts[top] == 0, "the top-order block was split");
+
+        for (auto k = order; k < top; ++k) {
+            check(counts[k] == 1, "every split left an unused upper half");
+        }
+
+        // The buddy of "a" is the unused block of the requested order.
+        auto* b = static_cast<std::byte*>(resource.allocate(size));
+        check(b == a + size, "the buddy was handed out next");
+        check(resource.free_block_count(order) == 0, "the buddy was used up");
+
+        // A used buddy prevents merging.
+        resource.deallocate(a, size);
+        check(resource.free_block_count(order) == 1, "the block was not merged with its used buddy");
+        check(resource.free_block_count(order + 1) == 1, "nothing was merged");
+
+        resource.deallocate(b, size);
+        check(free_blocks(resource) == initial, "the blocks were merged back into the top-order block");
+        check(resource.allocated() == 0, "nothing is allocated");
+    }
+
+    auto test_requests_are_rounded_to_blocks() -> void
+    {
+        std::vector<std::byte> buffer(buffer_size);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        const auto initial = free_blocks(resource);
+        const auto overhead = resource.allocation_overhead();
+
+        auto* p = resource.allocate(3 * min_block_size);
+
+        check(resource.allocated() == 3 * min_block_size, "allocated() counts the requested bytes");
+        check(resource.allocation_overhead() == overhead + min_block_size, "the request was rounded up to 4 blocks");
+
+        auto* q = resource.allocate(1, 4096);
+        check(reinterpret_cast<std::uintptr_t>(q) % 4096 == 0, "the allocation is aligned");
+
+        resource.deallocate(q, 1, 4096);
+        resource.deallocate(p, 3 * min_block_size);
+
+        check(free_blocks(resource) == initial, "the blocks were merged back");
+        check(resource.allocation_overhead() == overhead, "the overhead was restored");
+    }
+
+    auto test_freeing_everything_restores_top_block() -> void
+    {
+        std::vector<std::byte> buffer(buffer_size);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        const auto initial = free_blocks(resource);
+
+        std::vector<void*> blocks;
+
+        try {
+            for (;;) {
+                blocks.push_back(resource.allocate(100));
+            }
+        }
+        catch (const std::bad_alloc&) {
+        }
+
+        check(!blocks.empty(), "the arena held some blocks");
+        check(resource.allocated() == blocks.size() * 100, "allocated() counts every block");
+
+        for (std::size_t k = 0; k < initial.size(); ++k) {
+            check(resource.free_block_count(k) == 0 || block_size_of(k) < 100, "the arena is exhausted");
+        }
+
+        // Free every other block first, so that most merges happen in the second pass.
+        for (std::size_t i = 0; i < blocks.size(); i += 2) {
+            resource.deallocate(blocks[i], 100);
+        }
+
+        for (std::size_t i = 1; i < blocks.size(); i += 2) {
+            resource.deallocate(blocks[i], 100);
+        }
+
+        const auto counts = free_blocks(resource);
+
+        check(counts == initial, "the free lists were restored");
+        check(counts[top_order(counts)] == 1, "the top-order block was restored");
+        check(resource.allocated() == 0, "nothing is allocated");
+    }
+
+    auto test_invalid_requests_are_rejected() -> void
+    {
+        std::vector<std::byte> buffer(buffer_size);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        const auto initial = free_blocks(resource);
+
+        for (auto [bytes, alignment] : {std::pair{buffer_size, std::size_t{16}},
+                                        std::pair{std::size_t{16}, 2 * resource_type::max_alignment}}) {
+            bool rejected = false;
+
+            try {
+                resource.allocate(bytes, alignment);
+            }
+            catch (const std::bad_alloc&) {
+                rejected = true;
+            }
+
+            check(rejected, "the request was rejected");
+            check(free_blocks(resource) == initial, "the rejected request changed nothing");
+        }
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"split_and_merge", test_split_and_merge},
+        {"requests_are_rounded_to_blocks", test_requests_are_rounded_to_blocks},
+        {"freeing_everything_restores_top_block", test_freeing_everything_restores_top_block},
+        {"invalid_requests_are_rejected", test_invalid_requests_are_rejected}
+    });
+}
@@ -27,3 +27,185 @@ clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -o fbr
     -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
     -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
 
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -O2 -DNDEBUG -o alloc_benchmark alloc_benchmark.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -O2 -DNDEBUG -o alloc_replay alloc_replay.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -O2 -DNDEBUG -o fragmentation_benchmark fragmentation_benchmark.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -O2 -DNDEBUG -pthread -o contention_benchmark contention_benchmark.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o memory_budget_resource_test memory_budget_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o persistent_buffer_resource_test persistent_buffer_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o mapped_buffer_test mapped_buffer_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o static_buffer_resource_test static_buffer_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o buddy_buffer_resource_test buddy_buffer_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o synchronized_fixed_buffer_resource_test synchronized_fixed_buffer_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o synchronized_capped_memory_pool_test synchronized_capped_memory_pool_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o slab_resource_test slab_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o tracing_resource_test tracing_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
+
+clang++ -std=c++17 -stdlib=libc++ -nostdinc++ -fsanitize=undefined -O0 -g -pthread -o sharded_buffer_resource_test sharded_buffer_resource_test.cpp \
+    -I/opt/irods-externals/boost1.67.0-0/include \
+    -I/opt/irods-externals/clang6.0-0/include/c++/v1 \
+    -I/opt/irods-externals/fmt6.1.2-1/include \
+    -L/opt/irods-externals/boost1.67.0-0/lib \
+    -L/opt/irods-externals/clang6.0-0/lib \
+    -L/opt/irods-externals/fmt6.1.2-1/lib \
+    -lboost_container \
+    -lfmt \
+    -Wl,-rpath=/opt/irods-externals/boost1.67.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/clang6.0-0/lib \
+    -Wl,-rpath=/opt/irods-externals/fmt6.1.2-1/lib
@@ -0,0 +1,118 @@
+#ifndef IRODS_BULK_ALLOCATION_HPP
+#define IRODS_BULK_ALLOCATION_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <cstddef>
+
+namespace irods::experimental::pmr
+{
+    /// A \p bulk_resource is an interface implemented by memory resources that can allocate
+    /// many blocks of the same size faster than one call to \p allocate() per block (e.g.
+    /// \p fixed_buffer_resource).
+    ///
+    /// A memory resource can only derive from \p boost::container::pmr::memory_resource once,
+    /// so this interface is a separate base class. Use the free functions \p allocate_bulk()
+    /// and \p deallocate_bulk(), which work with every memory resource.
+    ///
+    /// \since 4.2.11
+    class bulk_resource
+    {
+    public:
+        /// Allocates \p _count blocks of \p _bytes bytes, each aligned to \p _alignment.
+        ///
+        /// Either all blocks are allocated or none are. Each block is an allocation of its own
+        /// and may be deallocated individually. The blocks are not necessarily contiguous.
+        ///
+        /// \param[in]  _count     The number of blocks.
+        /// \param[in]  _bytes     The size of each block.
+        /// \param[in]  _alignment The alignment of each block.
+        /// \param[out] _out       Receives the address of each block. Must have room for
+        ///                        \p _count pointers.
+        ///
+        /// \throws std::bad_alloc If the blocks could not be allocated.
+        ///
+        /// \since 4.2.11
+        auto allocate_bulk(std::size_t _count, std::size_t _bytes, std::size_t _alignment, void** _out) -> void
+        {
+            do_allocate_bulk(_count, _bytes, _alignment, _out);
+        } // allocate_bulk
+
+        /// Deallocates \p _count blocks of \p _bytes bytes aligned to \p _alignment. The blocks
+        /// do not need to come from a single call to \p allocate_bulk().
+        ///
+        /// \since 4.2.11
+        auto deallocate_bulk(void* const* _p, std::size_t _count, std::size_t _bytes, std::size_t _alignment) -> void
+        {
+            do_deallocate_bulk(_p, _count, _bytes, _alignment);
+        } // deallocate_bulk
+
+    protected:
+        ~bulk_resource() = default;
+
+        virtual auto do_allocate_bulk(std::size_t _count, std::size_t _bytes, std::size_t _alignment, void** _out) -> void = 0;
+
+        virtual auto do_deallocate_bulk(void* const* _p, std::size_t _count, std::size_t _bytes, std::size_t _alignment) -> void = 0;
+    }; // bulk_resource
+
+    /// Allocates \p _count blocks of \p _bytes bytes aligned to \p _alignment from
+    /// \p _resource.
+    ///
+    /// Resources implementing \p bulk_resource serve the request in one call. Other resources
+    /// are called once per block. Either way, all blocks are allocated or none are.
+    ///
+    /// \throws std::bad_alloc If the blocks could not be allocated, or anything
+    ///                        \p _resource throws.
+    ///
+    /// \since 4.2.11
+    inline auto allocate_bulk(boost::container::pmr::memory_resource& _resource,
+                              std::size_t _count,
+                              std::size_t _bytes,
+                              std::size_t _alignment,
+                              void** _out) -> void
+    {
+        if (auto* r = dynamic_cast<bulk_resource*>(&_resource); r) {
+            r->allocate_bulk(_count, _bytes, _alignment, _out);
+            return;
+        }
+
+        std::size_t n = 0;
+
+        try {
+            for (; n < _count; ++n) {
+                _out[n] = _resource.allocate(_bytes, _alignment);
+            }
+        }
+        catch (...) {
+            while (n > 0) {
+                _resource.deallocate(_out[--n], _bytes, _alignment);
+            }
+
+            throw;
+        }
+    } // allocate_bulk
+
+    /// Deallocates \p _count blocks of \p _bytes bytes aligned to \p _alignment that were
+    /// allocated from \p _resource.
+    ///
+    /// \since 4.2.11
+    inline auto deallocate_bulk(boost::container::pmr::memory_resource& _resource,
+                                void* const* _p,
+                                std::size_t _count,
+                                std::size_t _bytes,
+                                std::size_t _alignment) -> void
+    {
+        if (auto* r = dynamic_cast<bulk_resource*>(&_resource); r) {
+            r->deallocate_bulk(_p, _count, _bytes, _alignment);
+            return;
+        }
+
+        for (std::size_t i = 0; i < _count; ++i) {
+            _resource.deallocate(_p[i], _bytes, _alignment);
+        }
+    } // deallocate_bulk
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_BULK_ALLOCATION_HPP
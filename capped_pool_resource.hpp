@@ -0,0 +1,339 @@
+#ifndef IRODS_CAPPED_POOL_RESOURCE_HPP
+#define IRODS_CAPPED_POOL_RESOURCE_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+#include "instrumented_resource.hpp"
+
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/pool_options.hpp>
+#include <boost/container/pmr/synchronized_pool_resource.hpp>
+#include <boost/container/pmr/unsynchronized_pool_resource.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace irods::experimental::pmr
+{
+    /// Counters describing how well the pools of a \p capped_pool_resource absorb requests.
+    ///
+    /// \since 4.2.11
+    struct pool_statistics
+    {
+        /// The number of allocations requested from the resource.
+        std::size_t requests;
+
+        /// The number of requests served by a pool (small enough, and aligned to at most
+        /// \p boost::container::pmr::memory_resource::max_align bytes).
+        std::size_t pooled_requests;
+
+        /// The number of allocations the pools made from the buffer (new chunks and the pools'
+        /// own bookkeeping).
+        std::size_t chunk_allocations;
+
+        /// The number of bytes drawn from the buffer, including headers and padding.
+        std::size_t buffer_in_use;
+
+        /// Returns the fraction of pooled requests that did not have to allocate from the
+        /// buffer, or zero if there were no pooled requests.
+        auto hit_rate() const noexcept -> double
+        {
+            if (pooled_requests == 0) {
+                return 0;
+            }
+
+            return 1.0 - std::min(1.0, static_cast<double>(chunk_allocations) / static_cast<double>(pooled_requests));
+        } // hit_rate
+    }; // struct pool_statistics
+
+    /// Derives pool options from the request sizes recorded by an \p instrumented_resource
+    /// during a representative run.
+    ///
+    /// \p largest_required_pool_block is set to the smallest size class that covers
+    /// \p _coverage percent of the requests. The rest is passed to the buffer, where rare large
+    /// requests do not strand memory in mostly empty pools.
+    ///
+    /// \p max_blocks_per_chunk is set to an eighth of the peak number of live pooled requests
+    /// of the busiest size class, so that at most an eighth of a pool sits in a partially
+    /// used chunk. Boost.Container caps the value at 32, so this only makes a difference for
+    /// small workloads.
+    ///
+    /// \param[in] _profile  The requests of the workload.
+    /// \param[in] _coverage The percentage (0-100) of requests the pools should serve.
+    ///
+    /// \return The default options if \p _profile is empty.
+    ///
+    /// \since 4.2.11
+    inline auto tune_pool_options(const instrumented_resource& _profile, double _coverage = 99.0)
+        -> boost::container::pmr::pool_options
+    {
+        boost::container::pmr::pool_options options;
+
+        std::uint64_t total = 0;
+
+        for (std::size_t i = 0; i < instrumented_resource::size_class_count; ++i) {
+            total += _profile.allocate_latencies(i).count();
+        }
+
+        if (total == 0) {
+            return options;
+        }
+
+        std::uint64_t covered = 0;
+        std::uint64_t peak = 0;
+
+        for (std::size_t i = 0; i < instrumented_resource::size_class_count; ++i) {
+            covered += _profile.allocate_latencies(i).count();
+            peak = std::max(peak, _profile.peak_allocations(i));
+
+            if (static_cast<double>(covered) >= _coverage / 100.0 * static_cast<double>(total)) {
+                // The final size class is unbounded. Zero selects the largest pool available.
+                options.largest_required_pool_block = instrumented_resource::size_class_limit(i);
+                break;
+            }
+        }
+
+        std::size_t blocks = 1;
+
+        while (blocks < 32 && blocks * 8 < peak) {
+            blocks *= 2;
+        }
+
+        options.max_blocks_per_chunk = blocks;
+
+        return options;
+    } // tune_pool_options
+
+    /// A \p capped_pool_resource is a pool resource whose memory comes from a
+    /// \p fixed_buffer_resource, so that the pools and everything else are subject to a single
+    /// cap.
+    ///
+    /// Requests up to \p options().largest_required_pool_block bytes are served from pools of
+    /// fixed-size blocks, which avoids the header and the search of the buffer for most small
+    /// objects. Larger requests go straight to the buffer, and so do requests aligned to more
+    /// than \p boost::container::pmr::memory_resource::max_align bytes, because the pools
+    /// ignore alignment. The pools and the buffer report how much memory is actually drawn
+    /// from the buffer and how often the pools had to go back to it (see \p statistics()).
+    ///
+    /// For bounded-memory string workloads, a plain \p fixed_buffer_resource using two-level
+    /// segregated fit is the better choice. Building 100k \p pmr::string objects (see
+    /// alloc_benchmark), it was the fastest configuration and drew the least memory from the
+    /// buffer:
+    /// - 16 characters: 2.9 ms, against 4.7 ms with default pool options and 3.8 ms with
+    ///   options from \p tune_pool_options();
+    /// - 64 characters: 5.6 ms, against 8.7 ms with default options and 9.1 ms with tuned
+    ///   options. The pools round every string up to a power of two.
+    ///
+    /// The pool layer pays off when the objects are small and of few sizes, so that saving
+    /// the block header of each object outweighs the cost of the extra layer, or when the
+    /// synchronized pool layer is needed to share the buffer between threads. Tuned options
+    /// keep rare large requests from creating pools that are hardly used, but they are not
+    /// faster than the defaults for every workload.
+    ///
+    /// \tparam ByteRep      The memory representation for the underlying buffer (see
+    ///                      \p fixed_buffer_resource).
+    /// \tparam PoolResource The pool layer. Either
+    ///                      \p boost::container::pmr::unsynchronized_pool_resource or
+    ///                      \p boost::container::pmr::synchronized_pool_resource. The latter
+    ///                      makes the whole stack thread-safe, because the pool calls the
+    ///                      buffer while holding its lock.
+    ///
+    /// \since 4.2.11
+    template <typename ByteRep, typename PoolResource = boost::container::pmr::unsynchronized_pool_resource>
+    class capped_pool_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Constructs a \p capped_pool_resource using the given buffer as the allocation
+        /// source.
+        ///
+        /// \param[in] _buffer      The buffer that will be used for allocations.
+        /// \param[in] _buffer_size The size of the buffer in bytes.
+        /// \param[in] _options     The configuration of the pools (see \p tune_pool_options()).
+        /// \param[in] _strategy    The algorithm used by the buffer.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        capped_pool_resource(ByteRep* _buffer,
+                             std::int64_t _buffer_size,
+                             const boost::container::pmr::pool_options& _options = {},
+                             allocation_strategy _strategy = allocation_strategy::two_level_segregated_fit)
+            : boost::container::pmr::memory_resource{}
+            , buffer_{_buffer, _buffer_size, _strategy}
+            , counter_{&buffer_}
+            , pool_{_options, &counter_}
+            , largest_pooled_size_{pool_.options().largest_required_pool_block}
+            , requests_{}
+            , pooled_requests_{}
+        {
+        } // capped_pool_resource
+
+        capped_pool_resource(const capped_pool_resource&) = delete;
+        auto operator=(const capped_pool_resource&) -> capped_pool_resource& = delete;
+
+        ~capped_pool_resource() = default;
+
+        /// Returns the options in effect, after the pool layer adjusted them to its limits.
+        ///
+        /// \since 4.2.11
+        auto options() const -> boost::container::pmr::pool_options
+        {
+            return pool_.options();
+        } // options
+
+        /// Returns the buffer all memory is drawn from.
+        ///
+        /// Reading the buffer is not synchronized with other threads. Use \p statistics()
+        /// while the resource is in use.
+        ///
+        /// \since 4.2.11
+        auto buffer() const noexcept -> const fixed_buffer_resource<ByteRep>&
+        {
+            return buffer_;
+        } // buffer
+
+        /// Returns the counters of the resource. The values are a snapshot when other threads
+        /// are allocating.
+        ///
+        /// \since 4.2.11
+        auto statistics() const -> pool_statistics
+        {
+            const auto lock = counter_.lock_buffer();
+
+            const auto requests = requests_.load(std::memory_order_relaxed);
+            const auto pooled_requests = pooled_requests_.load(std::memory_order_relaxed);
+
+            // Every request the pools do not serve is passed to the buffer as is.
+            const auto upstream_allocations = counter_.allocations();
+            const auto unpooled_requests = requests - pooled_requests;
+
+            return {requests,
+                    pooled_requests,
+                    upstream_allocations > unpooled_requests ? upstream_allocations - unpooled_requests : 0,
+                    buffer_.allocated() + buffer_.allocation_overhead()};
+        } // statistics
+
+        /// Returns all memory held by the pools to the buffer, invalidating every allocation.
+        ///
+        /// \since 4.2.11
+        auto release() -> void
+        {
+            pool_.release();
+        } // release
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            requests_.fetch_add(1, std::memory_order_relaxed);
+
+            if (is_over_aligned(_alignment)) {
+                return counter_.allocate(_bytes, _alignment);
+            }
+
+            if (_bytes <= largest_pooled_size_) {
+                pooled_requests_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return pool_.allocate(_bytes, _alignment);
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            if (is_over_aligned(_alignment)) {
+                counter_.deallocate(_p, _bytes, _alignment);
+                return;
+            }
+
+            pool_.deallocate(_p, _bytes, _alignment);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        static constexpr bool is_synchronized = std::is_same_v<PoolResource, boost::container::pmr::synchronized_pool_resource>;
+
+        // The pools only guarantee "max_align" and ignore the requested alignment, so stricter
+        // requests are passed to the buffer.
+        static constexpr auto is_over_aligned(std::size_t _alignment) noexcept -> bool
+        {
+            return _alignment > boost::container::pmr::memory_resource::max_align;
+        } // is_over_aligned
+
+        // Counts the allocations the pool layer makes from the buffer. When the pool layer is
+        // synchronized, the calls to the buffer are also serialized with statistics(). The
+        // pool's own lock cannot be used for that, because it is not accessible.
+        class counting_resource
+            : public boost::container::pmr::memory_resource
+        {
+        public:
+            explicit counting_resource(boost::container::pmr::memory_resource* _upstream)
+                : upstream_{_upstream}
+                , allocations_{}
+                , mutex_{}
+            {
+            }
+
+            // Returns the number of allocations made from the buffer.
+            auto allocations() const noexcept -> std::size_t
+            {
+                return allocations_.load(std::memory_order_relaxed);
+            }
+
+            // Returns a lock on the buffer, or an empty lock if the pool layer is not
+            // synchronized.
+            auto lock_buffer() const -> std::unique_lock<std::mutex>
+            {
+                if constexpr (is_synchronized) {
+                    return std::unique_lock{mutex_};
+                }
+                else {
+                    return {};
+                }
+            }
+
+        protected:
+            auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+            {
+                const auto lock = lock_buffer();
+                auto* p = upstream_->allocate(_bytes, _alignment);
+                allocations_.fetch_add(1, std::memory_order_relaxed);
+                return p;
+            }
+
+            auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+            {
+                const auto lock = lock_buffer();
+                upstream_->deallocate(_p, _bytes, _alignment);
+            }
+
+            auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+            {
+                return this == &_other;
+            }
+
+        private:
+            boost::container::pmr::memory_resource* upstream_;
+            std::atomic<std::size_t> allocations_;
+            mutable std::mutex mutex_;
+        }; // class counting_resource
+
+        fixed_buffer_resource<ByteRep> buffer_;
+        counting_resource counter_;
+        PoolResource pool_;
+        std::size_t largest_pooled_size_;
+        std::atomic<std::size_t> requests_;
+        std::atomic<std::size_t> pooled_requests_;
+    }; // capped_pool_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_CAPPED_POOL_RESOURCE_HPP
@@ -0,0 +1,489 @@
+// Benchmarks the string-building workload from alloc_test.cpp on several threads at once, to
+// measure how memory resources scale under contention.
+//
+// Usage: contention_benchmark [--threads 1,2,4,...] [--strings N] [--length N] [--warmup N]
+//                             [--repetitions N] [--max-size BYTES] [--seed N]
+//                             [--filter SUBSTRING] [--format table|csv|json]
+//
+// Every thread copies --strings inputs of --length characters into its own pmr::vector of
+// pmr::string. Three phases are timed by wall clock, from the moment all threads are released
+// until the last one finishes:
+//
+//   build        Every thread builds its vector.
+//   local_free   Every thread destroys the vector it built.
+//   remote_free  Every thread destroys the vector built by the next thread, so that all memory
+//                is returned by a thread other than the one that allocated it.
+//
+// Thread creation is not timed. The remote_free phase runs on a separate build and only for
+// resources shared by all threads. Resources created per thread are not thread-safe.
+//
+// Each case describes how the threads obtain memory:
+//
+//   per thread  Every thread has its own resource over an equal slice of the buffer.
+//   mutex       All threads share one non-thread-safe resource behind a std::mutex.
+//   otherwise   All threads share one thread-safe resource.
+//
+// All buffer-based cases share a single --max-size buffer, committed up front, except for
+// sharded_buffer_resource, which maps and commits a node-local buffer per shard. "scaling" is
+// the build throughput relative to the same case on one thread.
+
+#include "benchmark_support.hpp"
+#include "capped_pool_resource.hpp"
+#include "fixed_buffer_resource.hpp"
+#include "mapped_buffer.hpp"
+#include "memory_budget_resource.hpp"
+#include "shared_buffer_resource.hpp"
+#include "sharded_buffer_resource.hpp"
+#include "slab_resource.hpp"
+#include "synchronized_capped_memory_pool.hpp"
+#include "synchronized_fixed_buffer_resource.hpp"
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/string.hpp>
+#include <boost/container/pmr/synchronized_pool_resource.hpp>
+#include <boost/container/pmr/unsynchronized_pool_resource.hpp>
+#include <boost/container/pmr/vector.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+namespace bench = irods::experimental::pmr::bench;
+
+struct options
+{
+    std::vector<std::size_t> threads;
+    std::size_t strings = 20'000;
+    std::size_t length = 32;
+    std::size_t warmup = 1;
+    std::size_t repetitions = 5;
+    std::size_t max_size = 200'000'000;
+    std::uint32_t seed = 1;
+    std::string filter;
+    bench::output_format format = bench::output_format::table;
+};
+
+// Serializes every call to a resource that is not thread-safe.
+class locked_resource
+    : public pmr::memory_resource
+{
+public:
+    explicit locked_resource(pmr::memory_resource& _upstream)
+        : upstream_{_upstream}
+        , mtx_{}
+    {
+    }
+
+protected:
+    auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+    {
+        std::lock_guard lk{mtx_};
+        return upstream_.allocate(_bytes, _alignment);
+    }
+
+    auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+    {
+        std::lock_guard lk{mtx_};
+        upstream_.deallocate(_p, _bytes, _alignment);
+    }
+
+    auto do_is_equal(const pmr::memory_resource& _other) const noexcept -> bool override
+    {
+        return this == &_other;
+    }
+
+private:
+    pmr::memory_resource& upstream_;
+    std::mutex mtx_;
+}; // class locked_resource
+
+// Constructs the resources for the given number of threads (one entry per thread, possibly
+// the same resource for all), hands them to the callback and tears them down again.
+// Construction and destruction are not timed.
+using stack_factory = std::function<void(std::size_t, const std::function<void(const std::vector<pmr::memory_resource*>&)>&)>;
+
+struct benchmark_case
+{
+    std::string name;
+    bool shared;
+    stack_factory make_stacks;
+};
+
+using string_vector = pmr::vector<pmr::string>;
+
+auto parse_list(std::string_view _list) -> std::vector<std::size_t>
+{
+    std::vector<std::size_t> values;
+
+    while (!_list.empty()) {
+        const auto comma = _list.find(',');
+        values.push_back(std::stoul(std::string{_list.substr(0, comma)}));
+        _list = (comma == std::string_view::npos) ? std::string_view{} : _list.substr(comma + 1);
+    }
+
+    return values;
+}
+
+// Returns the powers of two up to the number of hardware threads, plus the number of hardware
+// threads itself.
+auto default_thread_counts() -> std::vector<std::size_t>
+{
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> counts;
+
+    for (std::size_t n = 1; n < hardware; n *= 2) {
+        counts.push_back(n);
+    }
+
+    counts.push_back(hardware);
+
+    return counts;
+}
+
+auto parse_options(int _argc, char** _argv) -> options
+{
+    options opts;
+
+    for (int i = 1; i < _argc; ++i) {
+        const std::string_view arg = _argv[i];
+
+        if (i + 1 >= _argc) {
+            throw std::invalid_argument{fmt::format("missing value for option [{}]", arg)};
+        }
+
+        const std::string value = _argv[++i];
+
+        if      (arg == "--threads")     { opts.threads = parse_list(value); }
+        else if (arg == "--strings")     { opts.strings = std::stoul(value); }
+        else if (arg == "--length")      { opts.length = std::stoul(value); }
+        else if (arg == "--warmup")      { opts.warmup = std::stoul(value); }
+        else if (arg == "--repetitions") { opts.repetitions = std::stoul(value); }
+        else if (arg == "--max-size")    { opts.max_size = std::stoul(value); }
+        else if (arg == "--seed")        { opts.seed = static_cast<std::uint32_t>(std::stoul(value)); }
+        else if (arg == "--filter")      { opts.filter = value; }
+        else if (arg == "--format")      { opts.format = bench::to_output_format(value); }
+        else {
+            throw std::invalid_argument{fmt::format("unknown option [{}]", arg)};
+        }
+    }
+
+    if (opts.threads.empty()) {
+        opts.threads = default_thread_counts();
+    }
+
+    if (std::find(std::begin(opts.threads), std::end(opts.threads), 0) != std::end(opts.threads)) {
+        throw std::invalid_argument{"--threads must not contain zero"};
+    }
+
+    if (opts.repetitions == 0) {
+        throw std::invalid_argument{"--repetitions must be greater than zero"};
+    }
+
+    return opts;
+}
+
+auto generate_strings(std::size_t _count, std::size_t _length, std::mt19937& _gen) -> std::vector<std::string>
+{
+    constexpr std::string_view charset = "0123456789"
+                                         "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                         "abcdefghijklmnopqrstuvwxyz";
+
+    std::uniform_int_distribution<std::size_t> dist{0, charset.size() - 1};
+    std::vector<std::string> strings(_count);
+
+    for (auto& s : strings) {
+        s.resize(_length);
+        for (auto& c : s) {
+            c = charset[dist(_gen)];
+        }
+    }
+
+    return strings;
+}
+
+// Runs "_work" on "_threads" threads and returns the time, in milliseconds, between releasing
+// the threads and the last one finishing. If any thread throws, the first exception is
+// rethrown after all threads have finished.
+auto run_threads(std::size_t _threads, const std::function<void(std::size_t)>& _work) -> double
+{
+    std::atomic<bool> go{false};
+    std::atomic<std::size_t> ready{0};
+    std::mutex error_mtx;
+    std::exception_ptr error;
+
+    std::vector<std::thread> workers;
+    workers.reserve(_threads);
+
+    for (std::size_t i = 0; i < _threads; ++i) {
+        workers.emplace_back([&, i] {
+            ready.fetch_add(1);
+
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            try {
+                _work(i);
+            }
+            catch (...) {
+                std::lock_guard lk{error_mtx};
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+    }
+
+    while (ready.load() < _threads) {
+        std::this_thread::yield();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+auto build(std::optional<string_vector>& _out, pmr::memory_resource& _resource, const std::vector<std::string>& _inputs)
+    -> void
+{
+    auto& strings = _out.emplace(&_resource);
+
+    for (const auto& s : _inputs) {
+        strings.emplace_back(s.data(), s.size());
+    }
+
+    // Keep the result observable so the loop cannot be optimized away.
+    if (strings.size() != _inputs.size()) {
+        throw std::logic_error{"benchmark produced the wrong number of strings"};
+    }
+}
+
+// A fixed_buffer_resource using the two-level segregated fit strategy, optionally topped by
+// another resource.
+template <typename Upper = void>
+struct buffer_stack
+{
+    buffer_stack(std::byte* _buffer, std::int64_t _buffer_size)
+        : buffer{_buffer, _buffer_size, ie::allocation_strategy::two_level_segregated_fit}
+        , upper{&buffer}
+    {
+    }
+
+    auto top() -> pmr::memory_resource& { return upper; }
+
+    ie::fixed_buffer_resource<std::byte> buffer;
+    Upper upper;
+};
+
+template <>
+struct buffer_stack<void>
+{
+    buffer_stack(std::byte* _buffer, std::int64_t _buffer_size)
+        : buffer{_buffer, _buffer_size, ie::allocation_strategy::two_level_segregated_fit}
+    {
+    }
+
+    auto top() -> pmr::memory_resource& { return buffer; }
+
+    ie::fixed_buffer_resource<std::byte> buffer;
+};
+
+// Returns a factory giving every thread its own stack over an equal slice of the buffer.
+template <typename Stack>
+auto per_thread(std::byte* _buffer, std::size_t _buffer_size) -> stack_factory
+{
+    return [_buffer, _buffer_size](std::size_t _threads, const auto& _run) {
+        // Page-aligned slices keep neighboring threads off each other's cache lines.
+        const auto slice = _buffer_size / _threads / 4096 * 4096;
+        std::vector<std::unique_ptr<Stack>> stacks;
+        std::vector<pmr::memory_resource*> resources;
+
+        for (std::size_t i = 0; i < _threads; ++i) {
+            stacks.push_back(std::make_unique<Stack>(_buffer + i * slice, static_cast<std::int64_t>(slice)));
+            resources.push_back(&stacks.back()->top());
+        }
+
+        _run(resources);
+    };
+}
+
+auto make_cases(std::byte* _buffer, std::size_t _buffer_size) -> std::vector<benchmark_case>
+{
+    const auto size = static_cast<std::int64_t>(_buffer_size);
+    constexpr auto tlsf = ie::allocation_strategy::two_level_segregated_fit;
+
+    return {
+        {"new_delete_resource", true, [](std::size_t _threads, const auto& _run) {
+            _run(std::vector<pmr::memory_resource*>(_threads, pmr::new_delete_resource()));
+        }},
+        {"fixed_buffer_resource(two_level_segregated_fit) per thread", false,
+         per_thread<buffer_stack<>>(_buffer, _buffer_size)},
+        {"unsynchronized_pool_resource/fixed_buffer_resource per thread", false,
+         per_thread<buffer_stack<pmr::unsynchronized_pool_resource>>(_buffer, _buffer_size)},
+        {"slab_resource/fixed_buffer_resource per thread", false,
+         per_thread<buffer_stack<ie::slab_resource>>(_buffer, _buffer_size)},
+        {"mutex/fixed_buffer_resource(two_level_segregated_fit)", true, [_buffer, size](std::size_t _threads, const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, tlsf};
+            locked_resource lr{fbr};
+            _run(std::vector<pmr::memory_resource*>(_threads, &lr));
+        }},
+        {"synchronized_pool_resource/fixed_buffer_resource", true, [_buffer, size](std::size_t _threads, const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, tlsf};
+            pmr::synchronized_pool_resource spr{&fbr};
+            _run(std::vector<pmr::memory_resource*>(_threads, &spr));
+        }},
+        {"capped_pool_resource<synchronized>", true, [_buffer, size](std::size_t _threads, const auto& _run) {
+            ie::capped_pool_resource<std::byte, pmr::synchronized_pool_resource> cpr{_buffer, size};
+            _run(std::vector<pmr::memory_resource*>(_threads, &cpr));
+        }},
+        {"synchronized_fixed_buffer_resource", true, [_buffer, size](std::size_t _threads, const auto& _run) {
+            ie::synchronized_fixed_buffer_resource sfbr{_buffer, size};
+            _run(std::vector<pmr::memory_resource*>(_threads, &sfbr));
+        }},
+        {"shared_buffer_resource", true, [_buffer, size](std::size_t _threads, const auto& _run) {
+            ie::shared_buffer_resource sbr{_buffer, size, ie::open_mode::create};
+            _run(std::vector<pmr::memory_resource*>(_threads, &sbr));
+        }},
+        {"sharded_buffer_resource(per_node)", true, [size](std::size_t _threads, const auto& _run) {
+            ie::sharded_buffer_resource sbr{static_cast<std::size_t>(size), ie::shard_policy::per_node, tlsf, ie::commit_policy::immediate};
+            _run(std::vector<pmr::memory_resource*>(_threads, &sbr));
+        }},
+        {"sharded_buffer_resource(per_cpu)", true, [size](std::size_t _threads, const auto& _run) {
+            ie::sharded_buffer_resource sbr{static_cast<std::size_t>(size), ie::shard_policy::per_cpu, tlsf, ie::commit_policy::immediate};
+            _run(std::vector<pmr::memory_resource*>(_threads, &sbr));
+        }},
+        {"synchronized_capped_memory_pool", true, [size](std::size_t _threads, const auto& _run) {
+            ie::synchronized_capped_memory_pool scmp{size};
+            _run(std::vector<pmr::memory_resource*>(_threads, &scmp));
+        }},
+        {"memory_budget_resource", true, [size](std::size_t _threads, const auto& _run) {
+            ie::memory_budget_resource mbr{size};
+            _run(std::vector<pmr::memory_resource*>(_threads, &mbr));
+        }},
+    };
+}
+
+int main(int _argc, char** _argv)
+{
+    try {
+        const auto opts = parse_options(_argc, _argv);
+
+        // Committed up front, so that page faults are not part of any measurement.
+        ie::mapped_buffer buffer{opts.max_size, ie::page_policy::default_pages, ie::commit_policy::immediate};
+
+        std::mt19937 gen{opts.seed};
+        const auto inputs = generate_strings(opts.strings, opts.length, gen);
+
+        bench::report report;
+
+        for (const auto& c : make_cases(buffer.data(), opts.max_size)) {
+            if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) {
+                continue;
+            }
+
+            std::optional<double> single_thread_throughput;
+
+            for (const auto threads : opts.threads) {
+                std::vector<double> build_samples;
+                std::vector<double> local_free_samples;
+                std::vector<double> remote_free_samples;
+                std::string error;
+
+                for (std::size_t i = 0; i < opts.warmup + opts.repetitions && error.empty(); ++i) {
+                    try {
+                        c.make_stacks(threads, [&](const std::vector<pmr::memory_resource*>& _resources) {
+                            std::vector<std::optional<string_vector>> vectors(threads);
+
+                            const auto build_ms = run_threads(threads, [&](auto _t) { build(vectors[_t], *_resources[_t], inputs); });
+                            const auto local_free_ms = run_threads(threads, [&](auto _t) { vectors[_t].reset(); });
+
+                            std::optional<double> remote_free_ms;
+
+                            if (c.shared) {
+                                run_threads(threads, [&](auto _t) { build(vectors[_t], *_resources[_t], inputs); });
+                                remote_free_ms = run_threads(threads, [&](auto _t) { vectors[(_t + 1) % threads].reset(); });
+                            }
+
+                            if (i >= opts.warmup) {
+                                build_samples.push_back(build_ms);
+                                local_free_samples.push_back(local_free_ms);
+
+                                if (remote_free_ms) {
+                                    remote_free_samples.push_back(*remote_free_ms);
+                                }
+                            }
+                        });
+                    }
+                    catch (const std::bad_alloc&) {
+                        error = "bad_alloc";
+                    }
+                }
+
+                const auto b = bench::summarize(build_samples);
+                const auto total_strings = static_cast<double>(threads * opts.strings);
+                const auto throughput = b.p50 > 0 ? total_strings / b.p50 / 1e3 : 0.0;
+
+                if (threads == 1 && error.empty()) {
+                    single_thread_throughput = throughput;
+                }
+
+                report.add({bench::text("resource", c.name),
+                            bench::number("threads", threads),
+                            bench::number("strings_per_thread", opts.strings),
+                            bench::number("repetitions", b.samples),
+                            bench::number("build_median_ms", b.p50),
+                            bench::number("build_p90_ms", b.p90),
+                            bench::number("mstrings_per_second", throughput),
+                            single_thread_throughput && error.empty()
+                                ? bench::number("scaling", throughput / *single_thread_throughput)
+                                : bench::text("scaling", "-"),
+                            bench::number("local_free_median_ms", bench::summarize(local_free_samples).p50),
+                            remote_free_samples.empty()
+                                ? bench::text("remote_free_median_ms", "-")
+                                : bench::number("remote_free_median_ms", bench::summarize(remote_free_samples).p50),
+                            bench::text("error", error.empty() ? "-" : error)});
+            }
+        }
+
+        report.write(std::cout, opts.format);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
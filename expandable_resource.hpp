@@ -0,0 +1,76 @@
+#ifndef IRODS_EXPANDABLE_RESOURCE_HPP
+#define IRODS_EXPANDABLE_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <cstddef>
+
+namespace irods::experimental::pmr
+{
+    /// An \p expandable_resource is a memory resource that can resize an allocation without
+    /// moving it, when the memory around it allows.
+    ///
+    /// Containers normally grow by allocating a larger block, moving the elements and freeing
+    /// the old block. Trying \p try_expand() first avoids the move whenever the memory directly
+    /// behind the allocation is unused (see \p expanding_allocator).
+    ///
+    /// \since 4.2.11
+    class expandable_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Attempts to grow the allocation at \p _p to \p _new_size bytes without moving it.
+        ///
+        /// \param[in] _p        A pointer returned by \p allocate() on this resource.
+        /// \param[in] _old_size The size the allocation was requested (or last resized) with.
+        /// \param[in] _new_size The size requested. Must not be less than \p _old_size.
+        ///
+        /// \return \p true if the allocation now holds at least \p _new_size bytes. It must be
+        ///         deallocated with \p _new_size from then on. \p false if the allocation is
+        ///         unchanged.
+        ///
+        /// \since 4.2.11
+        auto try_expand(void* _p, std::size_t _old_size, std::size_t _new_size) -> bool
+        {
+            return do_try_expand(_p, _old_size, _new_size);
+        } // try_expand
+
+        /// Shrinks the allocation at \p _p to \p _new_size bytes without moving it, handing the
+        /// memory behind it back to the resource if possible.
+        ///
+        /// \param[in] _p        A pointer returned by \p allocate() on this resource.
+        /// \param[in] _old_size The size the allocation was requested (or last resized) with.
+        /// \param[in] _new_size The size requested. Must not be greater than \p _old_size.
+        ///
+        /// The allocation must be deallocated with \p _new_size from then on.
+        ///
+        /// \since 4.2.11
+        auto shrink_in_place(void* _p, std::size_t _old_size, std::size_t _new_size) -> void
+        {
+            do_shrink_in_place(_p, _old_size, _new_size);
+        } // shrink_in_place
+
+        /// Returns the number of bytes the allocation at \p _p can hold, which is at least the
+        /// size it was requested with. Growing the allocation up to this size with
+        /// \p try_expand() never fails.
+        ///
+        /// \param[in] _p A pointer returned by \p allocate() on this resource.
+        ///
+        /// \since 4.2.11
+        auto usable_size(const void* _p) const -> std::size_t
+        {
+            return do_usable_size(_p);
+        } // usable_size
+
+    protected:
+        virtual auto do_try_expand(void* _p, std::size_t _old_size, std::size_t _new_size) -> bool = 0;
+
+        virtual auto do_shrink_in_place(void* _p, std::size_t _old_size, std::size_t _new_size) -> void = 0;
+
+        virtual auto do_usable_size(const void* _p) const -> std::size_t = 0;
+    }; // expandable_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_EXPANDABLE_RESOURCE_HPP
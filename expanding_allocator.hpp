@@ -0,0 +1,251 @@
+#ifndef IRODS_EXPANDING_ALLOCATOR_HPP
+#define IRODS_EXPANDING_ALLOCATOR_HPP
+
+/// \file
+
+#include "expandable_resource.hpp"
+
+#include <boost/container/allocator_traits.hpp>
+#include <boost/container/detail/multiallocation_chain.hpp>
+#include <boost/container/detail/version_type.hpp>
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/string.hpp>
+#include <boost/container/vector.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <string>
+
+namespace irods::experimental::pmr
+{
+    /// An \p expanding_allocator is a polymorphic allocator that lets Boost.Container's
+    /// \p vector and \p basic_string grow in place.
+    ///
+    /// It implements Boost.Container's version 2 allocator interface. When the container runs
+    /// out of capacity, it asks the allocator to expand its buffer forward before allocating a
+    /// new one. If the memory resource is an \p expandable_resource (e.g.
+    /// \p fixed_buffer_resource) and the memory behind the buffer is unused, the buffer grows
+    /// and no element is moved. Otherwise, the allocator behaves like
+    /// \p boost::container::pmr::polymorphic_allocator.
+    ///
+    /// The capacity reported to the container always covers the whole block returned by the
+    /// resource, so slack left by the resource's rounding is used before anything is moved.
+    ///
+    /// \tparam T The type of the objects allocated.
+    ///
+    /// \since 4.2.11
+    template <typename T>
+    class expanding_allocator
+    {
+    public:
+        using value_type = T;
+        using pointer = T*;
+        using size_type = std::size_t;
+        using version = boost::container::dtl::version_type<expanding_allocator, 2>;
+
+        // Required by the version 2 interface. The node allocation functions that use it are
+        // not provided, so this allocator cannot be used with node-based containers.
+        using multiallocation_chain = boost::container::dtl::
+            transform_multiallocation_chain<boost::container::dtl::basic_multiallocation_chain<void*>, T>;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = expanding_allocator<U>;
+        }; // struct rebind
+
+        /// Constructs an \p expanding_allocator that uses the default memory resource.
+        ///
+        /// \since 4.2.11
+        expanding_allocator() noexcept
+            : expanding_allocator{nullptr}
+        {
+        } // expanding_allocator
+
+        /// Constructs an \p expanding_allocator that uses \p _resource, or the default memory
+        /// resource if \p _resource is null.
+        ///
+        /// \since 4.2.11
+        expanding_allocator(boost::container::pmr::memory_resource* _resource) noexcept
+            : resource_{_resource ? _resource : boost::container::pmr::get_default_resource()}
+            , expandable_{dynamic_cast<expandable_resource*>(resource_)}
+        {
+        } // expanding_allocator
+
+        template <typename U>
+        expanding_allocator(const expanding_allocator<U>& _other) noexcept
+            : resource_{_other.resource()}
+            , expandable_{dynamic_cast<expandable_resource*>(resource_)}
+        {
+        } // expanding_allocator
+
+        expanding_allocator(const expanding_allocator&) = default;
+        auto operator=(const expanding_allocator&) -> expanding_allocator& = default;
+
+        ~expanding_allocator() = default;
+
+        /// Returns the memory resource used by the allocator.
+        ///
+        /// \since 4.2.11
+        auto resource() const noexcept -> boost::container::pmr::memory_resource*
+        {
+            return resource_;
+        } // resource
+
+        /// Allocates memory for \p _n objects.
+        ///
+        /// \since 4.2.11
+        auto allocate(size_type _n) -> pointer
+        {
+            if (_n > max_size()) {
+                throw std::bad_alloc{};
+            }
+
+            return static_cast<pointer>(resource_->allocate(_n * sizeof(T), alignof(T)));
+        } // allocate
+
+        /// Deallocates memory for \p _n objects.
+        ///
+        /// \since 4.2.11
+        auto deallocate(pointer _p, size_type _n) noexcept -> void
+        {
+            resource_->deallocate(_p, _n * sizeof(T), alignof(T));
+        } // deallocate
+
+        auto max_size() const noexcept -> size_type
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(T);
+        } // max_size
+
+        /// Implements the version 2 allocator interface.
+        ///
+        /// Forward expansion is attempted first, first to \p _prefer_in_recvd_out_size and then
+        /// to \p _limit_size objects. Backward expansion is not supported.
+        ///
+        /// \param[in]     _command                  A combination of
+        ///                                          \p boost::container::allocation_type flags.
+        /// \param[in]     _limit_size               The minimum number of objects for expansion
+        ///                                          and allocation, or the current capacity
+        ///                                          for shrinking.
+        /// \param[in,out] _prefer_in_recvd_out_size The preferred number of objects on input.
+        ///                                          The resulting capacity on output.
+        /// \param[in,out] _reuse                    The buffer to expand or shrink on input.
+        ///                                          Null on output if a new buffer was
+        ///                                          allocated.
+        ///
+        /// \return The (possibly new) buffer, or null if \p nothrow_allocation was requested
+        ///         and the command failed.
+        ///
+        /// \throws std::bad_alloc If the command failed.
+        ///
+        /// \since 4.2.11
+        auto allocation_command(boost::container::allocation_type _command,
+                                size_type _limit_size,
+                                size_type& _prefer_in_recvd_out_size,
+                                pointer& _reuse) -> pointer
+        {
+            namespace bc = boost::container;
+
+            if (_reuse && expandable_) {
+                if (_command & bc::shrink_in_place) {
+                    // "_limit_size" is the current capacity.
+                    expandable_->shrink_in_place(_reuse, _limit_size * sizeof(T), _prefer_in_recvd_out_size * sizeof(T));
+                    _prefer_in_recvd_out_size = claim_usable_size(_reuse, _prefer_in_recvd_out_size);
+                    return _reuse;
+                }
+
+                if (_command & bc::expand_fwd) {
+                    // Every buffer handed out by this allocator spans its whole block, so the
+                    // current capacity can be derived from the block.
+                    const auto capacity = expandable_->usable_size(_reuse) / sizeof(T);
+
+                    for (const auto n : {_prefer_in_recvd_out_size, _limit_size}) {
+                        if (n <= max_size() && expandable_->try_expand(_reuse, capacity * sizeof(T), n * sizeof(T))) {
+                            _prefer_in_recvd_out_size = claim_usable_size(_reuse, n);
+                            return _reuse;
+                        }
+                    }
+                }
+            }
+
+            _reuse = nullptr;
+
+            if (_command & bc::allocate_new) {
+                for (const auto n : {_prefer_in_recvd_out_size, _limit_size}) {
+                    try {
+                        auto* p = allocate(n);
+                        _prefer_in_recvd_out_size = expandable_ ? claim_usable_size(p, n) : n;
+                        return p;
+                    }
+                    catch (const std::bad_alloc&) {
+                        // Retry with the minimum size.
+                    }
+                }
+            }
+
+            if (_command & bc::nothrow_allocation) {
+                return nullptr;
+            }
+
+            throw std::bad_alloc{};
+        } // allocation_command
+
+        /// Returns an allocator using the default memory resource, like
+        /// \p boost::container::pmr::polymorphic_allocator.
+        ///
+        /// \since 4.2.11
+        auto select_on_container_copy_construction() const -> expanding_allocator
+        {
+            return expanding_allocator{};
+        } // select_on_container_copy_construction
+
+    private:
+        // Grows the allocation of "_n" objects at "_p" to the number of objects its block can
+        // hold and returns that number. This cannot fail and never moves the allocation.
+        auto claim_usable_size(pointer _p, size_type _n) -> size_type
+        {
+            const auto usable = expandable_->usable_size(_p) / sizeof(T);
+
+            if (usable > _n) {
+                expandable_->try_expand(_p, _n * sizeof(T), usable * sizeof(T));
+                return usable;
+            }
+
+            return _n;
+        } // claim_usable_size
+
+        boost::container::pmr::memory_resource* resource_;
+        expandable_resource* expandable_;  // Same as "resource_", if it supports expansion.
+    }; // expanding_allocator
+
+    template <typename T, typename U>
+    auto operator==(const expanding_allocator<T>& _lhs, const expanding_allocator<U>& _rhs) noexcept -> bool
+    {
+        return *_lhs.resource() == *_rhs.resource();
+    } // operator==
+
+    template <typename T, typename U>
+    auto operator!=(const expanding_allocator<T>& _lhs, const expanding_allocator<U>& _rhs) noexcept -> bool
+    {
+        return !(_lhs == _rhs);
+    } // operator!=
+
+    /// A \p boost::container::vector that grows in place when possible.
+    ///
+    /// \since 4.2.11
+    template <typename T>
+    using expanding_vector = boost::container::vector<T, expanding_allocator<T>>;
+
+    /// A \p boost::container::basic_string that grows in place when possible.
+    ///
+    /// \since 4.2.11
+    template <typename CharT, typename Traits = std::char_traits<CharT>>
+    using basic_expanding_string = boost::container::basic_string<CharT, Traits, expanding_allocator<CharT>>;
+
+    /// \since 4.2.11
+    using expanding_string = basic_expanding_string<char>;
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_EXPANDING_ALLOCATOR_HPP
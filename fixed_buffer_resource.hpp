@@ -3,26 +3,69 @@
 
 /// \file
 
+#include "bulk_allocation.hpp"
+#include "expandable_resource.hpp"
+
 #include <boost/container/pmr/memory_resource.hpp>
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <climits>
+#include <cstdint>
 #include <cstddef>
 #include <memory>
 #include <ostream>
 #include <stdexcept>
-#include <tuple>
 #include <type_traits>
 
 /// A namespace containing components meant to be used with Boost.Container's PMR library.
 namespace irods::experimental::pmr
 {
+    /// Defines the algorithms a \p fixed_buffer_resource can use to locate an unused block
+    /// of memory.
+    ///
+    /// \since 4.2.11
+    enum class allocation_strategy
+    {
+        /// Walk the allocation table from the beginning of the buffer and use the first
+        /// unused block that satisfies the request.
+        first_fit,
+
+        /// Search the unused blocks whose sizes fall into the size class of the request (and
+        /// larger size classes) before falling back to \p first_fit.
+        segregated_fit,
+
+        /// Two-Level Segregated Fit (TLSF). Only size classes that are guaranteed to satisfy
+        /// the request are searched and the allocation table is never walked. Allocation and
+        /// deallocation run in constant time, at the cost of occasionally rejecting a request
+        /// that \p first_fit would have satisfied.
+        two_level_segregated_fit
+    }; // enum class allocation_strategy
+
     /// A \p fixed_buffer_resource is a special purpose memory resource class template that
     /// allocates memory from the buffer given on construction. It allows applications to
     /// enforce a cap on the amount of memory available to components.
     ///
-    /// This class implements a first-fit scheme and is NOT thread-safe.
+    /// This class implements a first-fit scheme and is NOT thread-safe. Unused blocks are also
+    /// tracked in segregated size classes so that the search can skip blocks that are in use
+    /// (see \p allocation_strategy).
+    ///
+    /// Allocations can be resized in place (see \p expandable_resource). An allocation grows
+    /// into the block directly behind it if that block is unused and large enough.
+    ///
+    /// While the last block of the buffer is the only unused one (e.g. as long as nothing has
+    /// been deallocated), requests are carved off the front of that block directly, without
+    /// searching, regardless of the allocation strategy.
+    ///
+    /// Many blocks of the same size can be allocated in one call (see \p bulk_resource). They
+    /// are carved back to back out of as few unused blocks as possible, which are located
+    /// through the size classes regardless of the allocation strategy.
+    ///
+    /// Short-lived allocations can be released all at once (see \p checkpoint() and
+    /// \p checkpoint_guard).
     ///
     /// \tparam ByteRep The memory representation for the underlying buffer. Must be one of
     ///                 the following:
@@ -33,48 +76,53 @@ namespace irods::experimental::pmr
     /// \since 4.2.11
     template <typename ByteRep>
     class fixed_buffer_resource
-        : public boost::container::pmr::memory_resource
+        : public expandable_resource
+        , public bulk_resource
     {
     public:
         static_assert(std::is_same_v<ByteRep, char> ||
                       std::is_same_v<ByteRep, unsigned char> ||
                       std::is_same_v<ByteRep, std::byte>);
 
+        /// Identifies a point in the life of the resource that can be returned to (see
+        /// \p checkpoint()).
+        ///
+        /// \since 4.2.11
+        class checkpoint_type
+        {
+        private:
+            friend class fixed_buffer_resource;
+
+            checkpoint_type(std::size_t _offset, std::size_t _depth, std::size_t _scope_bytes, std::size_t _scope_live) noexcept
+                : offset_{_offset}
+                , depth_{_depth}
+                , scope_bytes_{_scope_bytes}
+                , scope_live_{_scope_live}
+            {
+            } // checkpoint_type
+
+            std::size_t offset_;       // The header of the reserved block when the checkpoint was taken.
+            std::size_t depth_;        // The number of active checkpoints, including this one.
+            std::size_t scope_bytes_;  // The value of "control_block::scope_bytes" at the time.
+            std::size_t scope_live_;   // The value of "control_block::scope_live" at the time.
+        }; // class checkpoint_type
+
         /// Constructs a \p fixed_buffer_resource using the given buffer as the allocation
         /// source.
         ///
         /// \param[in] _buffer      The buffer that will be used for allocations.
         /// \param[in] _buffer_size The size of the buffer in bytes.
+        /// \param[in] _strategy    The algorithm used to locate unused memory.
         ///
         /// \throws std::invalid_argument If any of the incoming constructor arguments do not
         ///                               satisfy construction requirements.
         ///
         /// \since 4.2.11
-        fixed_buffer_resource(ByteRep* _buffer, std::int64_t _buffer_size)
-            : boost::container::pmr::memory_resource{}
-            , buffer_{_buffer}
-            , buffer_size_(_buffer_size)
-            , allocated_{}
-            , headers_{}
-        {
-            if (!_buffer || _buffer_size <= 0) {
-                const auto* msg_fmt = "fixed_buffer_resource: invalid constructor arguments "
-                                      "[buffer={}, size={}].";
-                throw std::invalid_argument{fmt::format(msg_fmt, fmt::ptr(_buffer), _buffer_size)};
-            }
-
-            std::size_t space_left = buffer_size_;
-
-            // Make sure the buffer is aligned for the header type.
-            if (!std::align(alignof(header), sizeof(header), buffer_, space_left)) {
-                throw std::runtime_error{"fixed_buffer_resource: internal memory alignment error. "};
-            }
-
-            headers_ = new (buffer_) header;
-            headers_->size = space_left - sizeof(header);
-            headers_->prev = nullptr;
-            headers_->next = nullptr;
-            headers_->used = false;
+        fixed_buffer_resource(ByteRep* _buffer,
+                              std::int64_t _buffer_size,
+                              allocation_strategy _strategy = allocation_strategy::first_fit)
+            : fixed_buffer_resource{_buffer, _buffer_size, _strategy, nullptr}
+        {
         } // fixed_buffer_resource
 
         fixed_buffer_resource(const fixed_buffer_resource&) = delete;
@@ -82,6 +130,14 @@ namespace irods::experimental::pmr
 
         ~fixed_buffer_resource() = default;
 
+        /// Returns the algorithm used to locate unused memory.
+        ///
+        /// \since 4.2.11
+        auto strategy() const noexcept -> allocation_strategy
+        {
+            return control_->strategy;
+        } // strategy
+
         /// Returns the number of bytes used by the client.
         ///
         /// The value returned does not include memory used for tracking allocations.
@@ -91,19 +147,217 @@ namespace irods::experimental::pmr
         /// \since 4.2.11
         auto allocated() const noexcept -> std::size_t
         {
-            return allocated_;
+            return control_->allocated;
         } // allocated
 
         /// Returns the number of bytes used for tracking allocations.
         ///
+        /// This includes the headers, alignment padding and any bytes that were too small to
+        /// be managed as a block of their own (i.e. everything that is neither allocated by the
+        /// client nor free).
+        ///
         /// \return An unsigned integral type.
         ///
         /// \since 4.2.11
         auto allocation_overhead() const noexcept -> std::size_t
         {
-            return 0;
+            return control_->buffer_size - control_->allocated - control_->free_bytes;
         } // allocation_overhead
 
+        /// Returns the number of bytes held by unused blocks.
+        ///
+        /// Not all of these bytes can be handed to the client. Every allocation needs a header
+        /// and may need padding.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto free_bytes() const noexcept -> std::size_t
+        {
+            return control_->free_bytes;
+        } // free_bytes
+
+        /// Returns the number of unused blocks.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto free_block_count() const noexcept -> std::size_t
+        {
+            return control_->free_blocks;
+        } // free_block_count
+
+        /// Returns the size of the largest unused block, or zero if the buffer is full.
+        ///
+        /// Only the largest non-empty size class is searched, so the cost is bounded by the
+        /// number of unused blocks of similar size rather than the size of the table.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto largest_free_block() const noexcept -> std::size_t
+        {
+            if (!control_->fl_bitmap) {
+                return 0;
+            }
+
+            const auto fl = highest_bit_index(control_->fl_bitmap);
+            const auto i = fl * sl_count + highest_bit_index(control_->sl_bitmaps[fl]);
+
+            std::size_t largest = 0;
+
+            for (auto* h = bin_head(i); h; h = next_free(h)) {
+                largest = std::max<std::size_t>(largest, h->size);
+            }
+
+            return largest;
+        } // largest_free_block
+
+        /// Returns the external fragmentation of the unused memory as a value in [0, 1].
+        ///
+        /// The value is computed as 1 - (largest_free_block() / free_bytes()). Zero means all
+        /// unused memory is in a single block. Values close to one mean that the unused memory
+        /// is scattered across many small blocks and that large requests are likely to fail
+        /// even though free_bytes() is large.
+        ///
+        /// \since 4.2.11
+        auto fragmentation() const noexcept -> double
+        {
+            if (control_->free_bytes == 0) {
+                return 0;
+            }
+
+            return 1.0 - static_cast<double>(largest_free_block()) / static_cast<double>(control_->free_bytes);
+        } // fragmentation
+
+        /// Returns whether a request for \p _bytes bytes aligned to \p _alignment is certain to
+        /// succeed.
+        ///
+        /// The check is conservative. A \p false result does not imply that \p allocate() will
+        /// throw, but a \p true result guarantees that it will not (unless the resource is
+        /// modified in between).
+        ///
+        /// \since 4.2.11
+        auto can_allocate(std::size_t _bytes, std::size_t _alignment = alignof(std::max_align_t)) const noexcept -> bool
+        {
+            const auto needed = space_needed(_bytes, _alignment);
+
+            if (needed < _bytes) {
+                return false;
+            }
+
+            // Rounding up to a size class makes the answer valid for every allocation strategy
+            // (see allocate_from_bins_good_fit).
+            return largest_free_block() >= round_up_to_size_class(needed);
+        } // can_allocate
+
+        /// Marks the current state so that everything allocated from now on can be released
+        /// at once by \p rewind().
+        ///
+        /// The outermost checkpoint reserves the last block of the buffer if it is unused.
+        /// Until that checkpoint is rewound, requests are carved off the front of the reserved
+        /// block without searching, and deallocating such memory only updates a counter. This
+        /// makes the destruction of short-lived objects cheap and lets \p rewind() run in
+        /// constant time.
+        /// Requests the reserved block cannot hold are served from the other unused blocks as
+        /// usual. That memory is not affected by \p rewind() and must be deallocated.
+        ///
+        /// While a checkpoint is active, the reserved block is reported as used, and memory
+        /// carved off it counts as allocated (rounded up to the size of its block) until it is
+        /// rewound, even if it is deallocated before.
+        ///
+        /// Checkpoints may be nested and must be rewound in the reverse order of their
+        /// creation. They are not synchronized, and are therefore not available on a
+        /// \p shared_buffer_resource.
+        ///
+        /// \since 4.2.11
+        auto checkpoint() noexcept -> checkpoint_type
+        {
+            auto& c = *control_;
+
+            if (c.scope_depth == 0) {
+                c.scope_offset = c.end_offset;
+                c.scope_bytes = 0;
+                c.scope_live = 0;
+
+                if (auto* tail = header_at(c.tail_offset); !tail->used) {
+                    remove_from_bin(tail);
+                    tail->used = true;
+                    c.scope_offset = c.tail_offset;
+                }
+            }
+
+            ++c.scope_depth;
+
+            // The reserved block always follows the memory carved off it.
+            const auto offset = c.scope_offset < c.end_offset ? c.tail_offset : c.end_offset;
+
+            return {offset, c.scope_depth, c.scope_bytes, c.scope_live};
+        } // checkpoint
+
+        /// Releases all memory carved off the reserved block since \p _checkpoint was taken
+        /// and ends the checkpoint.
+        ///
+        /// Every object allocated from that memory must have been deallocated (e.g. destroyed)
+        /// before. Debug builds assert that no more of these objects are alive than when
+        /// \p _checkpoint was taken, which detects objects that outlive their scope. Objects
+        /// of an enclosing scope deallocated in the meantime can hide such an object.
+        ///
+        /// Objects that lived in that memory must not be used afterwards, and must not be
+        /// deallocated again. Debug builds zero the released memory so that deallocating
+        /// such an object trips an assertion, as long as the memory has not been handed out
+        /// again.
+        ///
+        /// \param[in] _checkpoint The most recent active checkpoint of this resource.
+        ///
+        /// \since 4.2.11
+        auto rewind(const checkpoint_type& _checkpoint) noexcept -> void
+        {
+            auto& c = *control_;
+
+            assert(c.scope_depth > 0 && _checkpoint.depth_ == c.scope_depth);
+            assert(c.scope_live <= _checkpoint.scope_live_ && "An object outlives its checkpoint.");
+
+            if (_checkpoint.offset_ < c.end_offset) {
+                auto* h = header_at(_checkpoint.offset_);
+                [[maybe_unused]] const auto carved_end = c.tail_offset + sizeof(header);
+                [[maybe_unused]] auto poison_offset = _checkpoint.offset_ + sizeof(header) + sizeof(free_block_links);
+
+                // Every block from "h" to the end of the buffer is released by turning "h"
+                // back into the reserved block. The outermost checkpoint returns that block to
+                // the size classes, which requires merging it with an unused block in front.
+                h->size = c.end_offset - _checkpoint.offset_ - sizeof(header);
+                update_boundary_tag(h);
+
+                if (c.scope_depth == 1) {
+                    h->used = false;
+
+                    if (auto* prev = previous_header(h); prev && !prev->used) {
+                        remove_from_bin(prev);
+                        absorb_next_block(prev);
+                        h = prev;
+                        poison_offset = _checkpoint.offset_;
+                    }
+
+                    insert_into_bin(h);
+                }
+
+#ifndef NDEBUG
+                if (poison_offset < carved_end) {
+                    std::fill(base_ + poison_offset, base_ + carved_end, ByteRep{});
+                }
+#endif // NDEBUG
+            }
+
+            c.allocated -= c.scope_bytes - _checkpoint.scope_bytes_;
+            c.scope_bytes = _checkpoint.scope_bytes_;
+            c.scope_live = std::min(c.scope_live, _checkpoint.scope_live_);
+
+            if (--c.scope_depth == 0) {
+                c.scope_offset = null_offset;
+            }
+        } // rewind
+
         /// Writes the state of the allocation table to the output stream.
         ///
         /// \since 4.2.11
@@ -111,23 +365,178 @@ namespace irods::experimental::pmr
         {
             std::size_t i = 0;
 
-            for (auto* h = headers_; h; h = h->next) {
+            for (auto* h = first_header(); h; h = next_header(h)) {
                 _os << fmt::format("{:>3}. Header Info [{}]: {{previous={:14}, next={:14}, used={:>5}, data={:14}, data_size={}}}\n",
                                    i,
                                    fmt::ptr(h),
-                                   fmt::ptr(h->prev),
-                                   fmt::ptr(h->next),
-                                   h->used,
+                                   fmt::ptr(previous_header(h)),
+                                   fmt::ptr(next_header(h)),
+                                   static_cast<bool>(h->used),
                                    fmt::ptr(address_of_data_segment(h)),
-                                   h->size);
+                                   static_cast<std::size_t>(h->size));
                 ++i;
             }
         } // print
 
+        /// Invokes \p _func for every unused block.
+        ///
+        /// \p _func receives a pointer to and the size of the part of the block that the
+        /// resource does not read until the block is handed out again. Its contents may be
+        /// discarded (e.g. returned to the kernel).
+        ///
+        /// \param[in] _func A callable with the signature void(void*, std::size_t).
+        ///
+        /// \since 4.2.11
+        template <typename Function>
+        auto for_each_unused_block(Function _func) const -> void
+        {
+            for (auto fl_map = control_->fl_bitmap; fl_map; fl_map &= fl_map - 1) {
+                const auto fl = lowest_bit_index(fl_map);
+
+                for (auto sl_map = control_->sl_bitmaps[fl]; sl_map; sl_map &= sl_map - 1) {
+                    for (auto* h = bin_head(fl * sl_count + lowest_bit_index(sl_map)); h; h = next_free(h)) {
+                        // The free list links at the front of the data segment must be preserved.
+                        _func(address_of_data_segment(h) + sizeof(free_block_links), h->size - sizeof(free_block_links));
+                    }
+                }
+            }
+        } // for_each_unused_block
+
+        /// Verifies the allocation table and the size classes.
+        ///
+        /// Every header is visited, so the cost is proportional to the number of blocks. Meant
+        /// for validating a buffer that was not necessarily written by this object (e.g. one
+        /// left behind by a process that crashed). The size of the buffer recorded in the state
+        /// must be correct. Every other field is verified before it is used to locate memory.
+        ///
+        /// \return A boolean value indicating whether the state of the resource is intact.
+        ///
+        /// \since 4.2.11
+        auto is_consistent() const noexcept -> bool
+        {
+            const auto& c = *control_;
+
+            // Written so that corrupted offsets cannot overflow.
+            if (c.first_header_offset > c.buffer_size ||
+                c.end_offset > c.buffer_size - c.first_header_offset ||
+                (c.scope_offset != null_offset && c.scope_offset > c.end_offset))
+            {
+                return false;
+            }
+
+            std::size_t free_bytes = 0;
+            std::size_t free_blocks = 0;
+            std::size_t offset = 0;
+            std::size_t prev_size = 0;
+            std::size_t tail_offset = 0;
+            bool prev_used = true;
+
+            // Walk the allocation table. Sizes are checked before they are used to locate the
+            // next header, so a corrupted header cannot lead the walk past "end_offset", which
+            // lies within the buffer.
+            while (offset < c.end_offset) {
+                const auto* h = reinterpret_cast<const header*>(base_ + offset);
+
+                if (c.end_offset - offset < sizeof(header) ||
+                    h->size % granularity != 0 ||
+                    h->size > c.end_offset - offset - sizeof(header) ||
+                    h->prev_size != prev_size ||
+                    (!h->used && !prev_used))
+                {
+                    return false;
+                }
+
+                if (!h->used) {
+                    free_bytes += h->size;
+                    ++free_blocks;
+                }
+
+                prev_size = h->size;
+                prev_used = h->used;
+                tail_offset = offset;
+                offset += sizeof(header) + h->size;
+            }
+
+            if (offset != c.end_offset ||
+                tail_offset != c.tail_offset ||
+                (c.scope_depth == 0) != (c.scope_offset == null_offset) ||
+                (c.scope_depth == 0 && c.scope_live != 0) ||
+                free_bytes != c.free_bytes ||
+                free_blocks != c.free_blocks)
+            {
+                return false;
+            }
+
+            for (std::size_t fl = 0; fl < fl_count; ++fl) {
+                if (((c.fl_bitmap >> fl) & 1) != (c.sl_bitmaps[fl] != 0)) {
+                    return false;
+                }
+            }
+
+            // Every unused block must be reachable through exactly one size class.
+            std::size_t listed = 0;
+
+            for (std::size_t i = 0; i < bin_count; ++i) {
+                const auto non_empty = (c.sl_bitmaps[i / sl_count] >> (i % sl_count)) & 1;
+
+                if (non_empty != (c.bins[i] != null_offset)) {
+                    return false;
+                }
+
+                for (auto o = c.bins[i]; o != null_offset; o = links_of(header_at(o))->next_free) {
+                    // The header and the free list links must lie within the buffer.
+                    if (o >= c.end_offset ||
+                        c.end_offset - o < sizeof(header) + sizeof(free_block_links) ||
+                        o % granularity != 0 ||
+                        ++listed > free_blocks)
+                    {
+                        return false;
+                    }
+
+                    const auto* h = header_at(o);
+
+                    if (h->used || bin_index(h->size) != i) {
+                        return false;
+                    }
+                }
+            }
+
+            return listed == free_blocks;
+        } // is_consistent
+
     protected:
         auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
         {
-            for (auto* h = headers_; h; h = h->next) {
+            if (auto* p = allocate_from_reserved_block(_bytes, _alignment); p) {
+                return p;
+            }
+
+            if (auto* p = allocate_from_tail(_bytes, _alignment); p) {
+                return p;
+            }
+
+            switch (control_->strategy) {
+                case allocation_strategy::segregated_fit:
+                    if (auto* p = allocate_from_bins(_bytes, _alignment); p) {
+                        return p;
+                    }
+                    break;
+
+                case allocation_strategy::two_level_segregated_fit:
+                    if (auto* p = allocate_from_bins_good_fit(_bytes, _alignment); p) {
+                        return p;
+                    }
+
+                    // Walking the allocation table would defeat the bounded response time.
+                    throw std::bad_alloc{};
+
+                default:
+                    break;
+            }
+
+            // Fall back to the first-fit scheme. The size classes are only a hint, so this
+            // guarantees that a block is found whenever one exists.
+            for (auto* h = first_header(); h; h = next_header(h)) {
                 if (auto* p = allocate_block(_bytes, _alignment, h); p) {
                     return p;
                 }
@@ -138,161 +547,939 @@ namespace irods::experimental::pmr
 
         auto do_deallocate(void* _p, std::size_t _bytes, std::size_t /* _alignment */) -> void override
         {
-            void* data = *(static_cast<void**>(_p) - 1);
-            auto* h = reinterpret_cast<header*>(static_cast<ByteRep*>(data) - sizeof(header));
+            auto* h = header_of(_p);
 
-            assert(h != nullptr);
-            assert(h->size == _bytes);
+            assert(h->used);
+            assert(h->size >= _bytes);
+
+            // Memory carved off the reserved block is released by rewind(). The reserved
+            // block itself is never handed out, so reaching it means the memory was already
+            // rewound.
+            if (offset_of(h) >= control_->scope_offset) {
+                assert(offset_of(h) != control_->tail_offset);
+                assert(control_->scope_live > 0);
+                --control_->scope_live;
+                return;
+            }
 
             h->used = false;
 
-            coalesce_with_next_unused_block(h);
-            coalesce_with_next_unused_block(h->prev);
+            // Merge with the unused neighbors. Their sizes are about to change, so they must be
+            // removed from their size classes first.
+            if (auto* next = next_header(h); next && !next->used) {
+                remove_from_bin(next);
+                absorb_next_block(h);
+            }
+
+            if (auto* prev = previous_header(h); prev && !prev->used) {
+                remove_from_bin(prev);
+                absorb_next_block(prev);
+                h = prev;
+            }
+
+            insert_into_bin(h);
 
-            allocated_ -= _bytes;
+            control_->allocated -= _bytes;
         } // do_deallocate
 
+        auto do_try_expand(void* _p, std::size_t _old_size, std::size_t _new_size) -> bool override
+        {
+            auto* h = header_of(_p);
+
+            assert(h->used);
+            assert(h->size >= _old_size && _new_size >= _old_size);
+
+            const auto block_size = block_size_for(_new_size);
+
+            if (block_size < _new_size) {
+                return false;
+            }
+
+            // The tail of the data segment may already be large enough.
+            if (block_size > h->size) {
+                auto* next = next_header(h);
+
+                if (!next || next->used || h->size + sizeof(header) + next->size < block_size) {
+                    return false;
+                }
+
+                remove_from_bin(next);
+                absorb_next_block(h);
+                split_block(h, block_size);
+            }
+
+            // Memory carved off the reserved block counts as allocated in full.
+            if (offset_of(h) < control_->scope_offset) {
+                control_->allocated += _new_size - _old_size;
+            }
+
+            return true;
+        } // do_try_expand
+
+        auto do_shrink_in_place(void* _p, std::size_t _old_size, std::size_t _new_size) -> void override
+        {
+            auto* h = header_of(_p);
+
+            assert(h->used);
+            assert(h->size >= _old_size && _new_size <= _old_size);
+
+            // The blocks carved off the reserved block must stay used until rewind().
+            if (offset_of(h) >= control_->scope_offset) {
+                return;
+            }
+
+            split_block(h, block_size_for(_new_size));
+
+            control_->allocated -= _old_size - _new_size;
+        } // do_shrink_in_place
+
+        auto do_usable_size(const void* _p) const -> std::size_t override
+        {
+            return header_of(const_cast<void*>(_p))->size;
+        } // do_usable_size
+
+        auto do_allocate_bulk(std::size_t _count, std::size_t _bytes, std::size_t _alignment, void** _out) -> void override
+        {
+            // Derived classes may lock in do_allocate() and do_deallocate(), so this function
+            // only calls the implementations of this class.
+            const auto block_size = block_size_for(_bytes);
+
+            if (block_size < _bytes) {
+                throw std::bad_alloc{};
+            }
+
+            std::size_t n = 0;
+
+            try {
+                // The padding of over-aligned blocks depends on where each block lies. While a
+                // block is reserved, requests are carved off that block one at a time.
+                if (_alignment > granularity || control_->scope_offset < control_->end_offset) {
+                    for (; n < _count; ++n) {
+                        _out[n] = fixed_buffer_resource::do_allocate(_bytes, _alignment);
+                    }
+
+                    return;
+                }
+
+                while (n < _count) {
+                    auto* h = find_region(_count - n, block_size);
+
+                    if (!h) {
+                        throw std::bad_alloc{};
+                    }
+
+                    n += carve_blocks(h, _count - n, _bytes, block_size, _out + n);
+                }
+            }
+            catch (const std::bad_alloc&) {
+                while (n > 0) {
+                    fixed_buffer_resource::do_deallocate(_out[--n], _bytes, _alignment);
+                }
+
+                throw;
+            }
+        } // do_allocate_bulk
+
+        auto do_deallocate_bulk(void* const* _p, std::size_t _count, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            for (std::size_t i = 0; i < _count; ++i) {
+                fixed_buffer_resource::do_deallocate(_p[i], _bytes, _alignment);
+            }
+        } // do_deallocate_bulk
+
         auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
         {
             return this == &_other;
         } // do_is_equal
 
+        /// The state of a \p fixed_buffer_resource (defined below). It refers to blocks by their
+        /// offset from the first header only, so it stays valid when the buffer is mapped at a
+        /// different address.
+        ///
+        /// \since 4.2.11
+        struct control_block;
+
+        /// Constructs a \p fixed_buffer_resource whose state lives in \p _control instead of
+        /// the object itself (e.g. inside a shared memory segment).
+        ///
+        /// \param[in] _buffer      The buffer that will be used for allocations.
+        /// \param[in] _buffer_size The size of the buffer in bytes.
+        /// \param[in] _strategy    The algorithm used to locate unused memory. Ignored when
+        ///                         attaching.
+        /// \param[in] _control     The state to initialize or attach to. If null, the state
+        ///                         is stored in the object and initialized.
+        /// \param[in] _attach      Whether \p _control already describes \p _buffer.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        fixed_buffer_resource(ByteRep* _buffer,
+                              std::int64_t _buffer_size,
+                              allocation_strategy _strategy,
+                              control_block* _control,
+                              bool _attach = false)
+            : expandable_resource{}
+            , bulk_resource{}
+            , base_{}
+            , control_{_control ? _control : &local_control_}
+            , local_control_{}
+        {
+            if (!_buffer || _buffer_size <= 0 || (_attach && !_control)) {
+                const auto* msg_fmt = "fixed_buffer_resource: invalid constructor arguments "
+                                      "[buffer={}, size={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, fmt::ptr(_buffer), _buffer_size)};
+            }
+
+            if (_attach) {
+                base_ = _buffer + control_->first_header_offset;
+                return;
+            }
+
+            void* buffer = _buffer;
+            std::size_t space_left = _buffer_size;
+
+            // Make sure the buffer is aligned for the header type and can hold at least one block.
+            if (!std::align(alignof(header), min_split_size, buffer, space_left)) {
+                throw std::runtime_error{"fixed_buffer_resource: internal memory alignment error. "};
+            }
+
+            base_ = static_cast<ByteRep*>(buffer);
+
+            *control_ = control_block{};
+            control_->buffer_size = _buffer_size;
+            control_->strategy = _strategy;
+            control_->first_header_offset = static_cast<std::size_t>(base_ - _buffer);
+            control_->bins.fill(null_offset);
+
+            auto* h = new (base_) header;
+            h->prev_size = 0;
+            h->size = (space_left - sizeof(header)) & ~(granularity - 1);
+            h->used = false;
+
+            control_->end_offset = sizeof(header) + h->size;
+            control_->tail_offset = 0;
+            control_->scope_offset = null_offset;
+
+            insert_into_bin(h);
+        } // fixed_buffer_resource
+
+        /// Returns the state of the resource.
+        ///
+        /// \since 4.2.11
+        auto control() const noexcept -> control_block*
+        {
+            return control_;
+        } // control
+
     private:
         // Header associated with an allocation within the underlying memory buffer.
         // All data segments will be preceded by a header.
         //
         // Memory Layout:
         //
-        //     +-------------------------------------------------------------------------+
-        //     | padding | header |                    data segment                      |
-        //     +------------------+------------------------------------------------------+
-        //                        | padding | unaligned pointer | aligned pointer | data |
-        //                        +------------------------------------------------------+
+        //     +--------------------------------------------------------------+
+        //     | header | data segment | header | data segment | header | ... |
+        //     +--------------------------------------------------------------+
+        //
+        // Headers are aligned to "granularity" and every data segment is a multiple of
+        // "granularity" bytes, so each data segment starts and ends on a "granularity"
+        // boundary. The data segment of a used block begins with the client's memory (no
+        // per-allocation bookkeeping is stored) and extends to the next header, including any
+        // tail that was too small to split off.
+        //
+        // Requests with stricter alignment requirements are served by carving an unused
+        // block off the front of the chosen block, so that the next header ends exactly on the
+        // required boundary.
         //
-        struct header
+        // Headers act as boundary tags. The next header is found by skipping over the data
+        // segment, and the previous header is found through "prev_size", which mirrors the size
+        // of the block in front. Both neighbors are reachable in constant time without storing
+        // any pointers.
+        //
+        // Unused blocks are additionally linked into the size class (bin) matching their size.
+        // The links are stored in the data segment of the unused block itself, so they cost
+        // nothing while the block is in use:
+        //
+        //     +--------+-----------+-----------+--------+
+        //     | header | prev_free | next_free | unused |
+        //     +--------+-----------+-----------+--------+
+        //
+        struct alignas(std::max_align_t) header
         {
-            std::size_t size;   // Size of the memory block (excluding all management info).
-            header* prev;       // Pointer to the previous header block.
-            header* next;       // Pointer to the next header block.
-            bool used;          // Indicates whether the memory is in use.
+            std::size_t prev_size;                                  // Size of the previous block's data segment.
+            std::size_t size : sizeof(std::size_t) * CHAR_BIT - 1;  // Size of the data segment.
+            std::size_t used : 1;                                   // Indicates whether the memory is in use.
         }; // struct header
 
-        auto address_of_data_segment(header* _h) const noexcept -> ByteRep*
+        // Links stored at the beginning of the data segment of every unused block. Blocks are
+        // referenced by their offset from the first header, so the links remain valid when the
+        // buffer is mapped at a different address.
+        struct free_block_links
         {
-            return reinterpret_cast<ByteRep*>(_h) + sizeof(header);
-        } // address_of_data_segment
+            std::size_t prev_free;  // Offset of the previous unused block in the same size class.
+            std::size_t next_free;  // Offset of the next unused block in the same size class.
+        }; // struct free_block_links
+
+        // Marks the end of a size class list.
+        static constexpr std::size_t null_offset = ~std::size_t{0};
+
+        // Unused blocks are grouped into size classes using a two-level index. The first level
+        // splits sizes into power-of-two ranges and the second level divides each of those
+        // ranges into "sl_count" equally sized classes. Sizes smaller than "sl_count" are mapped
+        // onto a class of their own.
+        static constexpr std::size_t sl_log2 = 4;
+        static constexpr std::size_t sl_count = std::size_t{1} << sl_log2;
+        static constexpr std::size_t fl_count = sizeof(std::size_t) * CHAR_BIT - sl_log2 + 1;
+        static constexpr std::size_t bin_count = fl_count * sl_count;
 
-        auto aligned_alloc(std::size_t _bytes, std::size_t _alignment, header* _h)
-            -> std::tuple<void*, std::size_t>
+        // The alignment of every data segment and the unit in which block sizes are measured.
+        static constexpr std::size_t granularity = alignof(header);
+
+        // A remainder is only split off as a block of its own if it can hold a header and a
+        // non-empty data segment.
+        static constexpr std::size_t min_split_size = sizeof(header) + granularity;
+
+        static_assert(sizeof(free_block_links) <= granularity,
+                      "The smallest data segment must be able to hold the free list links.");
+
+    protected:
+        /// The alignment of every block. Requests that are not more strictly aligned are
+        /// served without padding.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t block_alignment = granularity;
+
+        /// The number of bytes in front of every block.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t header_size = sizeof(header);
+
+        struct control_block
         {
-            // The unused memory is located right after the header.
-            void* data = address_of_data_segment(_h);
+            std::size_t buffer_size;                       // Size of the buffer given on construction.
+            std::size_t first_header_offset;               // Offset of the first header from the buffer.
+            std::size_t end_offset;                        // Offset of the end of the last data segment.
+            std::size_t tail_offset;                       // Offset of the last header.
+            std::size_t scope_offset;                      // Offset of the block reserved by the outermost
+                                                           // checkpoint, "end_offset" if there is none,
+                                                           // or "null_offset" if no checkpoint is active.
+            std::size_t scope_depth;                       // Number of active checkpoints.
+            std::size_t scope_bytes;                       // Bytes carved off the reserved block.
+            std::size_t scope_live;                        // Blocks carved off the reserved block that
+                                                           // were not deallocated.
+            std::size_t allocated;                         // Bytes allocated by the client.
+            allocation_strategy strategy;
+            std::size_t free_bytes;                        // Sum of the sizes of the unused blocks.
+            std::size_t free_blocks;                       // Number of unused blocks.
+            std::size_t fl_bitmap;                         // Bit "i" is set if "sl_bitmaps[i]" is not zero.
+            std::array<std::size_t, fl_count> sl_bitmaps;  // Bit "j" of entry "i" is set if the size class
+                                                           // at "i * sl_count + j" is not empty.
+            std::array<std::size_t, bin_count> bins;       // Offsets of the heads of the size class lists.
+        }; // struct control_block
 
-            // Reserve space for the potentially unaligned pointer.
-            void* aligned_data = static_cast<ByteRep*>(data) + sizeof(void*);
-            auto space_left = _h->size - sizeof(void*);
+    private:
 
-            if (!std::align(_alignment, _bytes, aligned_data, space_left)) {
-                return {nullptr, 0};
+        static auto highest_bit_index(std::size_t _bits) noexcept -> std::size_t
+        {
+            assert(_bits != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+            return sizeof(std::size_t) * CHAR_BIT - 1 - static_cast<std::size_t>(__builtin_clzll(_bits));
+#else
+            std::size_t i = 0;
+            while (_bits >>= 1) {
+                ++i;
             }
+            return i;
+#endif
+        } // highest_bit_index
 
-            // Store the address of the original allocation directly before the
-            // aligned memory.
-            new (static_cast<ByteRep*>(aligned_data) - sizeof(void*)) void*{data};
+        static auto lowest_bit_index(std::size_t _bits) noexcept -> std::size_t
+        {
+            assert(_bits != 0);
 
-            return {aligned_data, space_left};
-        } // aligned_alloc
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_ctzll(_bits));
+#else
+            std::size_t i = 0;
+            while ((_bits & 1) == 0) {
+                _bits >>= 1;
+                ++i;
+            }
+            return i;
+#endif
+        } // lowest_bit_index
 
-        auto allocate_block(std::size_t _bytes, std::size_t _alignment, header* _h) -> void*
+        static auto bin_index(std::size_t _size) noexcept -> std::size_t
         {
-            if (_h->used) {
+            if (_size < sl_count) {
+                return _size;
+            }
+
+            const auto msb = highest_bit_index(_size);
+            const auto fl = msb - sl_log2 + 1;
+            const auto sl = (_size >> (msb - sl_log2)) & (sl_count - 1);
+
+            return fl * sl_count + sl;
+        } // bin_index
+
+        // Returns the smallest size whose size class only contains blocks that are at least
+        // "_size" bytes long.
+        static auto round_up_to_size_class(std::size_t _size) noexcept -> std::size_t
+        {
+            if (_size < sl_count) {
+                return _size;
+            }
+
+            return _size + (std::size_t{1} << (highest_bit_index(_size) - sl_log2)) - 1;
+        } // round_up_to_size_class
+
+        // Returns the index of the first non-empty size class at or above "_index", or
+        // "bin_count" if there isn't one.
+        auto find_non_empty_bin(std::size_t _index) const noexcept -> std::size_t
+        {
+            if (_index >= bin_count) {
+                return bin_count;
+            }
+
+            auto fl = _index / sl_count;
+            auto sl_map = control_->sl_bitmaps[fl] & (~std::size_t{0} << (_index % sl_count));
+
+            if (!sl_map) {
+                if (fl + 1 >= fl_count) {
+                    return bin_count;
+                }
+
+                const auto fl_map = control_->fl_bitmap & (~std::size_t{0} << (fl + 1));
+
+                if (!fl_map) {
+                    return bin_count;
+                }
+
+                fl = lowest_bit_index(fl_map);
+                sl_map = control_->sl_bitmaps[fl];
+            }
+
+            return fl * sl_count + lowest_bit_index(sl_map);
+        } // find_non_empty_bin
+
+        auto insert_into_bin(header* _h) noexcept -> void
+        {
+            const auto i = bin_index(_h->size);
+
+            auto& c = *control_;
+
+            c.free_bytes += _h->size;
+            ++c.free_blocks;
+
+            new (address_of_data_segment(_h)) free_block_links{null_offset, c.bins[i]};
+
+            if (auto* head = bin_head(i); head) {
+                links_of(head)->prev_free = offset_of(_h);
+            }
+
+            c.bins[i] = offset_of(_h);
+            c.fl_bitmap |= std::size_t{1} << (i / sl_count);
+            c.sl_bitmaps[i / sl_count] |= std::size_t{1} << (i % sl_count);
+        } // insert_into_bin
+
+        auto remove_from_bin(header* _h) noexcept -> void
+        {
+            const auto i = bin_index(_h->size);
+
+            auto& c = *control_;
+
+            c.free_bytes -= _h->size;
+            --c.free_blocks;
+
+            const auto* links = links_of(_h);
+
+            if (auto* prev = header_at(links->prev_free); prev) {
+                links_of(prev)->next_free = links->next_free;
+            }
+            else {
+                c.bins[i] = links->next_free;
+            }
+
+            if (auto* next = header_at(links->next_free); next) {
+                links_of(next)->prev_free = links->prev_free;
+            }
+
+            if (c.bins[i] == null_offset) {
+                auto& sl_map = c.sl_bitmaps[i / sl_count];
+
+                if (sl_map &= ~(std::size_t{1} << (i % sl_count)); !sl_map) {
+                    c.fl_bitmap &= ~(std::size_t{1} << (i / sl_count));
+                }
+            }
+        } // remove_from_bin
+
+        auto allocate_from_bins(std::size_t _bytes, std::size_t _alignment) -> void*
+        {
+            // Blocks in the request's own size class may be too small, so that class is searched
+            // first-fit. Blocks in the larger size classes almost always satisfy the request on
+            // the first attempt.
+            for (auto i = find_non_empty_bin(bin_index(block_size_for(_bytes))); i < bin_count; i = find_non_empty_bin(i + 1)) {
+                for (auto* h = bin_head(i); h;) {
+                    // "allocate_block" unlinks "h" on success, so capture the successor first.
+                    auto* successor = next_free(h);
+
+                    if (auto* p = allocate_block(_bytes, _alignment, h); p) {
+                        return p;
+                    }
+
+                    h = successor;
+                }
+            }
+
+            return nullptr;
+        } // allocate_from_bins
+
+        auto allocate_from_bins_good_fit(std::size_t _bytes, std::size_t _alignment) -> void*
+        {
+            const auto needed = space_needed(_bytes, _alignment);
+
+            if (needed < _bytes || needed > control_->buffer_size) {
                 return nullptr;
             }
 
-            // Return the block if it matches the requested number of bytes.
-            if (_bytes == _h->size) {
-                if (auto* aligned_data = std::get<void*>(aligned_alloc(_bytes, _alignment, _h)); aligned_data) {
-                    _h->used = true;
-                    allocated_ += _bytes;
-                    return aligned_data;
+            // Only the head of each size class is considered. Every block in the first class
+            // found is large enough, so the loop body normally executes exactly once.
+            const auto first = bin_index(round_up_to_size_class(needed));
+
+            for (auto i = find_non_empty_bin(first); i < bin_count; i = find_non_empty_bin(i + 1)) {
+                if (auto* p = allocate_block(_bytes, _alignment, bin_head(i)); p) {
+                    return p;
                 }
             }
 
-            // TODO Is it possible to compute the amount of memory needed to satisfy
-            // the allocation and alignment requirements? I'm not sure if this line
-            // is correct.
-            const auto max_space_needed = sizeof(header) + sizeof(void*) + _bytes + _alignment;
+            return nullptr;
+        } // allocate_from_bins_good_fit
+
+        // Returns an unused block that can hold "_count" blocks of "_block_size" bytes back to
+        // back. If there is none, returns the largest unused block instead, or null if that
+        // cannot hold a single block.
+        auto find_region(std::size_t _count, std::size_t _block_size) const noexcept -> header*
+        {
+            const auto stride = sizeof(header) + _block_size;
 
-            // Split the data segment managed by this header if it is large enough
-            // to satisfy the allocation request and management information.
-            if (max_space_needed < _h->size) {
-                auto [aligned_data, space_left] = aligned_alloc(_bytes, _alignment, _h);
+            if (_count <= control_->buffer_size / stride) {
+                const auto i = find_non_empty_bin(bin_index(round_up_to_size_class(_count * stride - sizeof(header))));
 
-                if (!aligned_data) {
-                    return nullptr;
+                if (i < bin_count) {
+                    return bin_head(i);
                 }
+            }
 
-                void* aligned_header_storage = static_cast<ByteRep*>(aligned_data) + _bytes;
-                space_left -= _bytes;
+            if (!control_->fl_bitmap) {
+                return nullptr;
+            }
 
-                if (!std::align(alignof(header), sizeof(header), aligned_header_storage, space_left)) {
-                    return nullptr;
+            const auto fl = highest_bit_index(control_->fl_bitmap);
+            const auto i = fl * sl_count + highest_bit_index(control_->sl_bitmaps[fl]);
+
+            header* largest = nullptr;
+
+            for (auto* h = bin_head(i); h; h = next_free(h)) {
+                if (!largest || h->size > largest->size) {
+                    largest = h;
                 }
+            }
+
+            return largest->size >= _block_size ? largest : nullptr;
+        } // find_region
+
+        // Splits the unused block "_h" into as many used blocks of "_block_size" bytes as it
+        // can hold (up to "_count") and stores their addresses in "_out". Returns the number
+        // of blocks. The neighbors of an unused block are always in use, so the remainder does
+        // not need to be merged with anything.
+        auto carve_blocks(header* _h, std::size_t _count, std::size_t _bytes, std::size_t _block_size, void** _out) noexcept -> std::size_t
+        {
+            const auto stride = sizeof(header) + _block_size;
+            const auto region = sizeof(header) + _h->size;
+            const auto count = std::min(_count, region / stride);
+
+            remove_from_bin(_h);
 
-                // Construct a new header after the memory managed by "_h".
-                // The new header manages unused memory.
-                auto* new_header = new (aligned_header_storage) header;
-                new_header->size = space_left - _bytes - sizeof(header);
-                new_header->prev = _h;
-                new_header->next = _h->next;
+            auto* p = reinterpret_cast<ByteRep*>(_h);
+            auto prev_size = _h->prev_size;
+            header* last = nullptr;
+
+            for (std::size_t i = 0; i < count; ++i, p += stride) {
+                last = new (p) header;
+                last->prev_size = prev_size;
+                last->size = _block_size;
+                last->used = true;
+
+                _out[i] = address_of_data_segment(last);
+                prev_size = _block_size;
+            }
+
+            // Same as allocate_block(). The remainder becomes an unused block if it is large
+            // enough to be useful, otherwise it stays attached to the last block.
+            if (const auto rest = region - count * stride; rest >= min_split_size) {
+                auto* new_header = new (p) header;
+                new_header->prev_size = _block_size;
+                new_header->size = rest - sizeof(header);
                 new_header->used = false;
 
-                // Update the allocation table links for the header just after the
-                // newly added header.
-                if (auto* next_header = _h->next; next_header) {
-                    next_header->prev = new_header;
-                }
+                update_boundary_tag(new_header);
+                insert_into_bin(new_header);
+            }
+            else {
+                last->size = last->size + rest;
+                update_boundary_tag(last);
+            }
 
-                // Adjust the current header's size and mark it as used.
-                _h->size = _bytes;
-                _h->next = new_header;
-                _h->used = true;
+            control_->allocated += count * _bytes;
 
-                allocated_ += _bytes;
+            return count;
+        } // carve_blocks
 
-                return aligned_data;
+        // Returns the size of the data segment used to satisfy a request for "_bytes" bytes.
+        static constexpr auto block_size_for(std::size_t _bytes) noexcept -> std::size_t
+        {
+            // Zero-byte requests still need a unique address.
+            const auto bytes = _bytes > 0 ? _bytes : 1;
+            return (bytes + granularity - 1) & ~(granularity - 1);
+        } // block_size_for
+
+        // Returns the smallest block size that is guaranteed to satisfy the request, no matter
+        // where the block lies in the buffer.
+        static constexpr auto space_needed(std::size_t _bytes, std::size_t _alignment) noexcept -> std::size_t
+        {
+            if (_alignment <= granularity) {
+                return block_size_for(_bytes);
             }
 
-            return nullptr;
+            // In the worst case, the client's memory begins "_alignment - granularity" bytes
+            // after the smallest block that can be carved off the front.
+            return block_size_for(_bytes) + min_split_size + _alignment - granularity;
+        } // space_needed
+
+        static auto align_up(ByteRep* _p, std::size_t _alignment) noexcept -> ByteRep*
+        {
+            const auto address = reinterpret_cast<std::uintptr_t>(_p);
+            const auto padding = (_alignment - address % _alignment) % _alignment;
+            return _p + padding;
+        } // align_up
+
+        static auto address_of_data_segment(header* _h) noexcept -> ByteRep*
+        {
+            return reinterpret_cast<ByteRep*>(_h) + sizeof(header);
+        } // address_of_data_segment
+
+        // The header always sits directly in front of the client's memory.
+        static auto header_of(void* _p) noexcept -> header*
+        {
+            return reinterpret_cast<header*>(static_cast<ByteRep*>(_p) - sizeof(header));
+        } // header_of
+
+        static auto links_of(header* _h) noexcept -> free_block_links*
+        {
+            return reinterpret_cast<free_block_links*>(address_of_data_segment(_h));
+        } // links_of
+
+        auto first_header() const noexcept -> header*
+        {
+            return reinterpret_cast<header*>(base_);
+        } // first_header
+
+        auto offset_of(header* _h) const noexcept -> std::size_t
+        {
+            return static_cast<std::size_t>(reinterpret_cast<ByteRep*>(_h) - base_);
+        } // offset_of
+
+        auto header_at(std::size_t _offset) const noexcept -> header*
+        {
+            return _offset != null_offset ? reinterpret_cast<header*>(base_ + _offset) : nullptr;
+        } // header_at
+
+        auto bin_head(std::size_t _index) const noexcept -> header*
+        {
+            return header_at(control_->bins[_index]);
+        } // bin_head
+
+        auto next_free(header* _h) const noexcept -> header*
+        {
+            return header_at(links_of(_h)->next_free);
+        } // next_free
+
+        auto next_header(header* _h) const noexcept -> header*
+        {
+            const auto next = offset_of(_h) + sizeof(header) + _h->size;
+            return next < control_->end_offset ? reinterpret_cast<header*>(base_ + next) : nullptr;
+        } // next_header
+
+        auto previous_header(header* _h) const noexcept -> header*
+        {
+            if (_h == first_header()) {
+                return nullptr;
+            }
+
+            return reinterpret_cast<header*>(reinterpret_cast<ByteRep*>(_h) - _h->prev_size - sizeof(header));
+        } // previous_header
+
+        // Keeps the boundary tag of the block following "_h" in sync with the size of "_h". If
+        // there is no such block, "_h" is the last block.
+        auto update_boundary_tag(header* _h) noexcept -> void
+        {
+            if (auto* next = next_header(_h); next) {
+                next->prev_size = _h->size;
+            }
+            else {
+                control_->tail_offset = offset_of(_h);
+            }
+        } // update_boundary_tag
+
+        // Serves the request from the front of the last block if that block is the only unused
+        // one, which holds for as long as the buffer is only appended to. The request takes over
+        // the header of the last block and a new header is written behind it, so no other block
+        // is visited. The last block is alone in its size class and stays in the same class
+        // for most requests, in which case only the head of that class needs to be updated.
+        // Returns null if the request must go through the allocation strategy.
+        auto allocate_from_tail(std::size_t _bytes, std::size_t _alignment) noexcept -> void*
+        {
+            auto& c = *control_;
+
+            if (c.free_blocks != 1 || _alignment > granularity) {
+                return nullptr;
+            }
+
+            auto* tail = header_at(c.tail_offset);
+            const auto block_size = block_size_for(_bytes);
+
+            // A tail that is (almost) used up is handed out whole by the allocation strategy.
+            if (tail->used || block_size < _bytes || tail->size < block_size + min_split_size) {
+                return nullptr;
+            }
+
+            const auto rest = tail->size - block_size - sizeof(header);
+            const auto same_class = bin_index(rest) == bin_index(tail->size);
+
+            if (!same_class) {
+                remove_from_bin(tail);
+            }
+
+            auto* new_tail = new (address_of_data_segment(tail) + block_size) header;
+            new_tail->prev_size = block_size;
+            new_tail->size = rest;
+            new_tail->used = false;
+
+            tail->size = block_size;
+            tail->used = true;
+
+            c.tail_offset = offset_of(new_tail);
+
+            if (same_class) {
+                new (address_of_data_segment(new_tail)) free_block_links{null_offset, null_offset};
+                c.bins[bin_index(rest)] = c.tail_offset;
+                c.free_bytes -= block_size + sizeof(header);
+            }
+            else {
+                insert_into_bin(new_tail);
+            }
+
+            c.allocated += _bytes;
+
+            return address_of_data_segment(tail);
+        } // allocate_from_tail
+
+        // Serves the request from the front of the block reserved by a checkpoint. Blocks carved
+        // off the reserved block (including the padding of over-aligned requests) stay used
+        // until rewind(), so the reserved block is always the last one and never needs to be
+        // merged with anything. Returns null if no block is reserved or if the reserved block
+        // is too small.
+        auto allocate_from_reserved_block(std::size_t _bytes, std::size_t _alignment) noexcept -> void*
+        {
+            auto& c = *control_;
+
+            if (c.scope_offset >= c.end_offset) {
+                return nullptr;
+            }
+
+            auto* h = header_at(c.tail_offset);
+            auto* data = address_of_data_segment(h);
+            auto* aligned_data = data;
+
+            if (_alignment > granularity && reinterpret_cast<std::uintptr_t>(data) % _alignment != 0) {
+                aligned_data = align_up(data + min_split_size, _alignment);
+            }
+
+            const auto block_size = block_size_for(_bytes);
+            const auto padding = static_cast<std::size_t>(aligned_data - data);
+
+            // The reserved block must survive the request.
+            if (block_size < _bytes || h->size < padding + block_size + min_split_size) {
+                return nullptr;
+            }
+
+            const auto rest = h->size - padding - block_size - sizeof(header);
+
+            if (padding > 0) {
+                h->size = padding - sizeof(header);
+                h = new (aligned_data - sizeof(header)) header;
+                h->prev_size = padding - sizeof(header);
+                h->used = true;
+            }
+
+            h->size = block_size;
+
+            auto* reserved = new (aligned_data + block_size) header;
+            reserved->prev_size = block_size;
+            reserved->size = rest;
+            reserved->used = true;
+
+            c.tail_offset = offset_of(reserved);
+            c.scope_bytes += block_size;
+            c.allocated += block_size;
+            ++c.scope_live;
+
+            return aligned_data;
+        } // allocate_from_reserved_block
+
+        auto allocate_block(std::size_t _bytes, std::size_t _alignment, header* _h) -> void*
+        {
+            if (_h->used) {
+                return nullptr;
+            }
+
+            auto* data = address_of_data_segment(_h);
+            auto* aligned_data = data;
+
+            // Data segments are always aligned to "granularity", so padding is only needed for
+            // over-aligned requests. The padding must be large enough to hold an unused block.
+            if (_alignment > granularity && reinterpret_cast<std::uintptr_t>(data) % _alignment != 0) {
+                aligned_data = align_up(data + min_split_size, _alignment);
+            }
+
+            const auto block_size = block_size_for(_bytes);
+            const auto padding = static_cast<std::size_t>(aligned_data - data);
+
+            if (block_size < _bytes || padding + block_size > _h->size) {
+                return nullptr;
+            }
+
+            remove_from_bin(_h);
+
+            // Hand the padding back as an unused block of its own. "_h" keeps managing the
+            // padding and a new header is constructed directly in front of the client's memory.
+            if (padding > 0) {
+                auto* new_header = new (aligned_data - sizeof(header)) header;
+                new_header->prev_size = padding - sizeof(header);
+                new_header->size = _h->size - padding;
+                new_header->used = false;
+
+                update_boundary_tag(new_header);
+
+                _h->size = padding - sizeof(header);
+
+                insert_into_bin(_h);
+
+                _h = new_header;
+            }
+
+            split_block(_h, block_size);
+
+            _h->used = true;
+            control_->allocated += _bytes;
+
+            return aligned_data;
         } // allocate_block
 
-        auto coalesce_with_next_unused_block(header* _h) -> void
+        // Shrinks the data segment of "_h" (which must not be linked into a size class) to
+        // "_block_size" bytes. The remainder is split off and merged with the block behind it if
+        // that block is unused. If the remainder is too small to be useful, it stays attached to
+        // "_h".
+        auto split_block(header* _h, std::size_t _block_size) noexcept -> void
         {
-            if (!_h || _h->used) {
+            if (_h->size - _block_size < min_split_size) {
                 return;
             }
 
-            auto* header_to_remove = _h->next;
+            // Construct a new header after the memory managed by "_h".
+            // The new header manages unused memory.
+            auto* new_header = new (address_of_data_segment(_h) + _block_size) header;
+            new_header->prev_size = _block_size;
+            new_header->size = _h->size - _block_size - sizeof(header);
+            new_header->used = false;
 
-            // Coalesce the memory blocks if they are not in use by the client.
-            // This means that "_h" will absorb the header at "_h->next".
-            if (header_to_remove && !header_to_remove->used) {
-                _h->size += header_to_remove->size;
-                _h->next = header_to_remove->next;
+            _h->size = _block_size;
 
-                // Make sure the links between the headers are updated appropriately.
-                // (i.e. "_h" and "header_to_remove->next" need their links updated).
-                if (auto* new_next_header = header_to_remove->next; new_next_header) {
-                    new_next_header->prev = _h;
-                }
+            // Update the boundary tag of the header just after the newly added header.
+            update_boundary_tag(new_header);
+
+            if (auto* next = next_header(new_header); next && !next->used) {
+                remove_from_bin(next);
+                absorb_next_block(new_header);
             }
-        } // coalesce_with_next_unused_block
 
-        void* buffer_;
-        std::size_t buffer_size_;
-        std::size_t allocated_;
-        header* headers_;
+            insert_into_bin(new_header);
+        } // split_block
+
+        // Merges the block following "_h" into "_h". The block following "_h" must be unused
+        // and neither block may be linked into a size class.
+        auto absorb_next_block(header* _h) noexcept -> void
+        {
+            auto* header_to_remove = next_header(_h);
+
+            assert(header_to_remove && !header_to_remove->used);
+
+            // The absorbed header becomes part of the data segment of "_h".
+            _h->size = _h->size + sizeof(header) + header_to_remove->size;
+
+            update_boundary_tag(_h);
+        } // absorb_next_block
+
+        ByteRep* base_;                  // The first header (i.e. the beginning of the aligned buffer).
+        control_block* control_;         // The state in use. Points to "local_control_" unless the
+                                         // state is managed by a derived class.
+        control_block local_control_;
     }; // fixed_buffer_resource
+
+    class shared_buffer_resource;
+
+    /// A \p checkpoint_guard takes a checkpoint of a \p fixed_buffer_resource on construction
+    /// and rewinds it on destruction, releasing the memory carved off the reserved block in
+    /// between (see \p fixed_buffer_resource::checkpoint()).
+    ///
+    /// Containers using the resource must be declared after the guard, so that they are
+    /// destroyed before the memory is released.
+    ///
+    /// \since 4.2.11
+    template <typename ByteRep>
+    class checkpoint_guard
+    {
+    public:
+        /// Takes a checkpoint of \p _resource.
+        ///
+        /// \param[in] _resource The resource to rewind. Must outlive this object.
+        ///
+        /// \since 4.2.11
+        explicit checkpoint_guard(fixed_buffer_resource<ByteRep>& _resource) noexcept
+            : resource_{_resource}
+            , checkpoint_{_resource.checkpoint()}
+        {
+        } // checkpoint_guard
+
+        /// Checkpoints are not available on a \p shared_buffer_resource (see
+        /// \p fixed_buffer_resource::checkpoint()).
+        explicit checkpoint_guard(shared_buffer_resource&) = delete;
+
+        checkpoint_guard(const checkpoint_guard&) = delete;
+        auto operator=(const checkpoint_guard&) -> checkpoint_guard& = delete;
+
+        /// Rewinds the resource to the checkpoint.
+        ~checkpoint_guard()
+        {
+            resource_.rewind(checkpoint_);
+        } // ~checkpoint_guard
+
+    private:
+        fixed_buffer_resource<ByteRep>& resource_;
+        typename fixed_buffer_resource<ByteRep>::checkpoint_type checkpoint_;
+    }; // checkpoint_guard
 } // namespace irods::experimental::pmr
 
 #endif // IRODS_FIXED_BUFFER_RESOURCE_HPP
@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <random>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <boost/container/pmr/memory_resource.hpp>
 #include <boost/container/pmr/unsynchronized_pool_resource.hpp>
@@ -16,9 +18,14 @@
 
 #include <fmt/format.h>
 
+#include "expanding_allocator.hpp"
 #include "fixed_buffer_resource.hpp"
+#include "test_support.hpp"
 
 namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
 
 class capped_memory_pool
     : public pmr::memory_resource
@@ -481,6 +488,662 @@ auto do_test(Allocator& _allocator) -> void
     }
 }
 
+constexpr std::array strategies{ie::allocation_strategy::first_fit,
+                                 ie::allocation_strategy::segregated_fit,
+                                 ie::allocation_strategy::two_level_segregated_fit};
+
+auto to_string(ie::allocation_strategy _strategy) -> std::string
+{
+    switch (_strategy) {
+        case ie::allocation_strategy::first_fit:                return "first_fit";
+        case ie::allocation_strategy::segregated_fit:           return "segregated_fit";
+        case ie::allocation_strategy::two_level_segregated_fit: return "two_level_segregated_fit";
+    }
+
+    return "unknown";
+}
+
+auto fill(void* _p, std::size_t _bytes, unsigned char _value) -> void
+{
+    std::fill_n(static_cast<unsigned char*>(_p), _bytes, _value);
+}
+
+// Returns whether "_p" still holds the bytes written by "fill()".
+auto holds(const void* _p, std::size_t _bytes, unsigned char _value) -> bool
+{
+    const auto* p = static_cast<const unsigned char*>(_p);
+    return std::all_of(p, p + _bytes, [_value](auto _c) { return _c == _value; });
+}
+
+// Checks that the resource is back to a single unused block holding all unused memory.
+auto check_empty(const ie::fixed_buffer_resource<std::byte>& _resource) -> void
+{
+    check(_resource.allocated() == 0, "nothing is allocated");
+    check(_resource.is_consistent(), "the resource is consistent");
+    check(_resource.free_block_count() == 1, "the unused memory was merged into one block");
+    check(_resource.largest_free_block() == _resource.free_bytes(), "the largest block holds all unused memory");
+}
+
+// Allocates and deallocates random sizes and alignments. The contents of every allocation
+// are verified before it is deallocated, which catches overlapping blocks.
+auto test_churn_keeps_resource_consistent(ie::allocation_strategy _strategy) -> void
+{
+    struct allocation
+    {
+        void* p;
+        std::size_t bytes;
+        std::size_t alignment;
+        unsigned char value;
+    };
+
+    std::vector<std::byte> buffer(1024 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    check(resource.strategy() == _strategy, "the strategy was selected");
+
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<std::size_t> small_size{1, 512};
+    std::uniform_int_distribution<std::size_t> large_size{513, 16 * 1024};
+    std::uniform_int_distribution<int> percent{0, 99};
+    constexpr std::array<std::size_t, 5> alignments{1, 8, 16, 64, 256};
+
+    std::vector<allocation> live;
+    std::size_t allocated = 0;
+    std::size_t failures = 0;
+
+    for (int i = 0; i < 20'000; ++i) {
+        if (live.empty() || percent(rng) < 55) {
+            const auto bytes = percent(rng) < 90 ? small_size(rng) : large_size(rng);
+            const auto alignment = alignments[static_cast<std::size_t>(percent(rng)) % alignments.size()];
+            const auto guaranteed = resource.can_allocate(bytes, alignment);
+
+            try {
+                auto* p = resource.allocate(bytes, alignment);
+                check(reinterpret_cast<std::uintptr_t>(p) % alignment == 0, "the allocation is aligned");
+
+                const auto value = static_cast<unsigned char>(i);
+                fill(p, bytes, value);
+                live.push_back({p, bytes, alignment, value});
+                allocated += bytes;
+            }
+            catch (const std::bad_alloc&) {
+                check(!guaranteed, "can_allocate() only guarantees requests that succeed");
+                ++failures;
+            }
+        }
+        else {
+            const auto index = static_cast<std::size_t>(rng() % live.size());
+            const auto a = live[index];
+
+            check(holds(a.p, a.bytes, a.value), "the contents of an allocation were preserved");
+
+            resource.deallocate(a.p, a.bytes, a.alignment);
+            allocated -= a.bytes;
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if (i % 500 == 0) {
+            check(resource.is_consistent(), "the resource stays consistent under churn");
+            check(resource.allocated() == allocated, "allocated() matches the live allocations");
+        }
+    }
+
+    check(failures > 0, "the buffer was exhausted at least once");
+
+    for (const auto& a : live) {
+        check(holds(a.p, a.bytes, a.value), "the contents of an allocation were preserved");
+        resource.deallocate(a.p, a.bytes, a.alignment);
+    }
+
+    check_empty(resource);
+}
+
+auto test_exhaustion_and_recovery(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(256 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    std::vector<void*> blocks;
+
+    try {
+        for (;;) {
+            blocks.push_back(resource.allocate(100));
+        }
+    }
+    catch (const std::bad_alloc&) {
+    }
+
+    check(!blocks.empty(), "the buffer held some blocks");
+    check(resource.allocated() == blocks.size() * 100, "allocated() counts every block");
+    check(resource.is_consistent(), "the full resource is consistent");
+
+    // Free every other block first, so that the remaining ones are merged from both sides.
+    for (std::size_t i = 0; i < blocks.size(); i += 2) {
+        resource.deallocate(blocks[i], 100);
+    }
+
+    check(resource.is_consistent(), "the fragmented resource is consistent");
+
+    for (std::size_t i = 1; i < blocks.size(); i += 2) {
+        resource.deallocate(blocks[i], 100);
+    }
+
+    check_empty(resource);
+
+    auto* p = resource.allocate(64 * 1024);
+    resource.deallocate(p, 64 * 1024);
+    check_empty(resource);
+}
+
+auto test_alignment_is_honored(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(256 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    std::vector<std::pair<void*, std::size_t>> blocks;
+
+    for (std::size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+        for (std::size_t bytes : {1, 24, 100, 1000}) {
+            auto* p = resource.allocate(bytes, alignment);
+            check(reinterpret_cast<std::uintptr_t>(p) % alignment == 0, "the allocation is aligned");
+            blocks.emplace_back(p, bytes);
+        }
+    }
+
+    check(resource.is_consistent(), "padding blocks keep the resource consistent");
+
+    for (auto [p, bytes] : blocks) {
+        resource.deallocate(p, bytes);
+    }
+
+    check_empty(resource);
+}
+
+// Checks the free block statistics of a resource whose last block is its only unused one.
+auto check_single_free_block(const ie::fixed_buffer_resource<std::byte>& _resource) -> void
+{
+    check(_resource.is_consistent(), "the resource is consistent");
+    check(_resource.free_block_count() == 1, "the last block is the only unused one");
+    check(_resource.largest_free_block() == _resource.free_bytes(), "the last block holds all unused memory");
+}
+
+// While the last block is the only unused one, requests are carved off its front. Freeing an
+// interior block disables that path until no other unused block is left.
+auto test_tail_allocation(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    std::vector<void*> blocks;
+
+    for (int i = 0; i < 16; ++i) {
+        auto* p = resource.allocate(100);
+        check(blocks.empty() || p > blocks.back(), "append-only requests are carved off the last block");
+        blocks.push_back(p);
+        check_single_free_block(resource);
+    }
+
+    const auto largest = resource.largest_free_block();
+    const auto free_bytes = resource.free_bytes();
+
+    resource.deallocate(blocks[5], 100);
+
+    check(resource.is_consistent(), "the resource is consistent");
+    check(resource.free_block_count() == 2, "the interior block is unused");
+    check(resource.largest_free_block() == largest, "the last block is still the largest");
+    check(resource.free_bytes() > free_bytes, "the interior block counts as unused");
+
+    // The strategy decides whether the interior block is reused. TLSF rounds the request up
+    // to the next size class, which the interior block is too small for.
+    auto* p = resource.allocate(100);
+
+    if (p == blocks[5]) {
+        check_single_free_block(resource);
+    }
+    else {
+        check(p > blocks.back(), "the request was served from the last block");
+        check(resource.is_consistent(), "the resource is consistent");
+        check(resource.free_block_count() == 2, "the interior block is still unused");
+    }
+
+    resource.deallocate(p, 100);
+
+    // Freeing the blocks behind the interior block merges them into the last block, and
+    // finally the interior block as well.
+    for (std::size_t i = blocks.size() - 1; i > 5; --i) {
+        resource.deallocate(blocks[i], 100);
+
+        check(resource.is_consistent(), "the resource is consistent");
+        check(resource.free_block_count() == (i == 6 ? 1 : 2), "the freed block was merged into the last block");
+        check(resource.largest_free_block() >= largest, "the last block grew");
+    }
+
+    check_single_free_block(resource);
+
+    p = resource.allocate(100);
+    check(p == blocks[5], "requests are carved off the last block again");
+    check_single_free_block(resource);
+
+    resource.deallocate(p, 100);
+
+    for (std::size_t i = 0; i < 5; ++i) {
+        resource.deallocate(blocks[i], 100);
+    }
+
+    check_empty(resource);
+}
+
+// An allocation grows into the unused block behind it without moving, and only if that
+// block is unused and large enough.
+auto test_try_expand_grows_in_place(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    auto* a = resource.allocate(100);
+    auto* b = resource.allocate(100);
+    auto* c = resource.allocate(100);
+    fill(a, 100, 1);
+    fill(c, 100, 3);
+
+    check(!resource.try_expand(a, 100, 200), "an allocation cannot grow into a used block");
+    check(resource.allocated() == 300, "the failed expansion changed nothing");
+
+    resource.deallocate(b, 100);
+    check(resource.try_expand(a, 100, 200), "an allocation grows into the unused block behind it");
+    check(resource.usable_size(a) >= 200, "the allocation holds the new size");
+    check(resource.allocated() == 300, "allocated() counts the new size");
+    check(resource.is_consistent(), "the resource is consistent after the expansion");
+    check(holds(a, 100, 1), "the contents were kept");
+
+    fill(a, 200, 1);
+    check(holds(c, 100, 3), "the expanded allocation does not overlap the next one");
+
+    check(!resource.try_expand(a, 200, 1000), "an allocation cannot grow into a block that is too small");
+    check(resource.allocated() == 300, "the failed expansion changed nothing");
+
+    // The last allocation can grow into the last block.
+    check(resource.try_expand(c, 100, 10'000), "the last allocation grows into the last block");
+    check(resource.is_consistent(), "the resource is consistent after the expansion");
+    check(holds(c, 100, 3), "the contents were kept");
+
+    resource.deallocate(c, 10'000);
+    resource.deallocate(a, 200);
+    check_empty(resource);
+}
+
+// Shrinking splits the memory behind the allocation off into an unused block, which serves
+// later requests.
+auto test_shrink_in_place_releases_memory(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    auto* p = static_cast<std::byte*>(resource.allocate(4000));
+    auto* q = static_cast<std::byte*>(resource.allocate(100));
+    fill(p, 4000, 1);
+
+    const auto free_bytes = resource.free_bytes();
+
+    resource.shrink_in_place(p, 4000, 1000);
+
+    check(resource.allocated() == 1100, "allocated() counts the new size");
+    check(resource.free_block_count() == 2, "the released memory became an unused block");
+    check(resource.free_bytes() > free_bytes, "the released memory counts as unused");
+    check(resource.is_consistent(), "the resource is consistent after shrinking");
+    check(holds(p, 1000, 1), "the contents were kept");
+
+    auto* r = static_cast<std::byte*>(resource.allocate(2000));
+    check(r > p && r < q, "the released memory was handed out again");
+
+    resource.deallocate(r, 2000);
+    resource.deallocate(q, 100);
+    resource.deallocate(p, 1000);
+    check_empty(resource);
+}
+
+// A vector whose buffer is followed by unused memory grows without moving its elements.
+auto test_expanding_vector_grows_in_place(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(1024 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    {
+        ie::expanding_vector<int> v{ie::expanding_allocator<int>{&resource}};
+
+        v.push_back(0);
+        const auto* data = v.data();
+
+        for (int i = 1; i < 10'000; ++i) {
+            v.push_back(i);
+            check(v.data() == data, "the vector grew in place");
+        }
+
+        // Once the memory behind the buffer is used, the vector has to move.
+        auto* blocker = resource.allocate(100);
+
+        for (int i = static_cast<int>(v.size()); i < 20'000; ++i) {
+            v.push_back(i);
+        }
+
+        check(v.data() != data, "the vector moved once it could not grow in place");
+        check(resource.is_consistent(), "the resource is consistent");
+
+        for (int i = 0; i < 20'000; ++i) {
+            check(v[static_cast<std::size_t>(i)] == i, "the vector kept its contents");
+        }
+
+        v.resize(100);
+        v.shrink_to_fit();
+        check(resource.is_consistent(), "the resource is consistent after shrinking");
+
+        for (int i = 0; i < 100; ++i) {
+            check(v[static_cast<std::size_t>(i)] == i, "the vector kept its contents");
+        }
+
+        resource.deallocate(blocker, 100);
+    }
+
+    check_empty(resource);
+}
+
+// Blocks allocated in bulk are aligned, do not overlap, and can be deallocated one by one or
+// in bulk. Alignments above the block alignment take the per-block path.
+auto test_bulk_allocation(ie::allocation_strategy _strategy) -> void
+{
+    constexpr std::size_t count = 100;
+    constexpr std::size_t bytes = 40;
+
+    std::vector<std::byte> buffer(256 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    for (std::size_t alignment : {8, 16, 64}) {
+        std::array<void*, count> blocks{};
+
+        resource.allocate_bulk(count, bytes, alignment, blocks.data());
+
+        for (std::size_t i = 0; i < count; ++i) {
+            check(reinterpret_cast<std::uintptr_t>(blocks[i]) % alignment == 0, "every block is aligned");
+            fill(blocks[i], bytes, static_cast<unsigned char>(i));
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            check(holds(blocks[i], bytes, static_cast<unsigned char>(i)), "the blocks do not overlap");
+        }
+
+        check(resource.allocated() == count * bytes, "allocated() counts every block");
+        check(resource.is_consistent(), "the resource is consistent after the bulk allocation");
+
+        std::vector<void*> even;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i % 2 == 1) {
+                resource.deallocate(blocks[i], bytes, alignment);
+            }
+            else {
+                even.push_back(blocks[i]);
+            }
+        }
+
+        check(resource.allocated() == even.size() * bytes, "blocks can be deallocated individually");
+        check(resource.is_consistent(), "the resource is consistent after the individual deallocations");
+
+        resource.deallocate_bulk(even.data(), even.size(), bytes, alignment);
+        check_empty(resource);
+    }
+}
+
+// A bulk request that cannot be satisfied allocates nothing.
+auto test_bulk_allocation_failure_changes_nothing(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    // Leave an unused block in front of the last one, so that the request spans both before
+    // it fails.
+    auto* a = resource.allocate(1000);
+    auto* b = resource.allocate(1000);
+    resource.deallocate(a, 1000);
+
+    const auto allocated = resource.allocated();
+    const auto free_bytes = resource.free_bytes();
+    const auto free_blocks = resource.free_block_count();
+
+    std::vector<void*> blocks(1000);
+
+    for (std::size_t alignment : {16, 64}) {
+        bool rejected = false;
+
+        try {
+            resource.allocate_bulk(blocks.size(), 100, alignment, blocks.data());
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "the request did not fit");
+        check(resource.allocated() == allocated, "allocated() is unchanged");
+        check(resource.free_bytes() == free_bytes, "free_bytes() is unchanged");
+        check(resource.free_block_count() == free_blocks, "free_block_count() is unchanged");
+        check(resource.is_consistent(), "the resource is consistent");
+    }
+
+    resource.deallocate(b, 1000);
+    check_empty(resource);
+}
+
+// Objects allocated inside a scope are released by rewind(), and the resource returns to
+// the state it had when the checkpoint was taken.
+auto test_rewind_restores_state(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(256 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    auto* outside = resource.allocate(1000);
+    fill(outside, 1000, 1);
+
+    const auto allocated = resource.allocated();
+    const auto free_bytes = resource.free_bytes();
+    const auto free_blocks = resource.free_block_count();
+
+    std::vector<void*> scoped;
+
+    {
+        ie::checkpoint_guard guard{resource};
+
+        check(resource.free_block_count() == free_blocks - 1, "the last block was reserved");
+
+        for (int i = 0; i < 100; ++i) {
+            auto* p = resource.allocate(100);
+            fill(p, 100, static_cast<unsigned char>(i));
+            scoped.push_back(p);
+        }
+
+        check(resource.is_consistent(), "the resource is consistent inside the scope");
+        check(resource.allocated() >= allocated + 100 * 100, "scoped memory counts as allocated");
+
+        for (auto* p : scoped) {
+            resource.deallocate(p, 100);
+        }
+
+        check(resource.allocated() >= allocated + 100 * 100, "scoped memory counts as allocated until it is rewound");
+    }
+
+    check(resource.allocated() == allocated, "allocated() was restored");
+    check(resource.free_bytes() == free_bytes, "free_bytes() was restored");
+    check(resource.free_block_count() == free_blocks, "free_block_count() was restored");
+    check(resource.is_consistent(), "the resource is consistent after the rewind");
+    check(holds(outside, 1000, 1), "memory allocated before the checkpoint was kept");
+
+    auto* p = resource.allocate(100);
+    check(p == scoped.front(), "the rewound memory is handed out again");
+
+    resource.deallocate(p, 100);
+    resource.deallocate(outside, 1000);
+    check_empty(resource);
+}
+
+// Rewinding an inner checkpoint only releases the memory carved off since that checkpoint.
+auto test_nested_checkpoints(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(256 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    {
+        ie::checkpoint_guard outer{resource};
+
+        auto* a = resource.allocate(64);
+        fill(a, 64, 1);
+
+        const auto allocated = resource.allocated();
+        void* inner_first = nullptr;
+
+        {
+            ie::checkpoint_guard inner{resource};
+
+            auto* b = resource.allocate(64);
+            auto* c = resource.allocate(200);
+            fill(b, 64, 2);
+            fill(c, 200, 3);
+            inner_first = b;
+
+            check(b > a, "the inner scope continues behind the outer one");
+            check(holds(a, 64, 1), "the outer scope's object was not overwritten");
+
+            resource.deallocate(c, 200);
+            resource.deallocate(b, 64);
+        }
+
+        check(resource.allocated() == allocated, "the inner rewind only released the inner scope");
+        check(resource.is_consistent(), "the resource is consistent between the rewinds");
+        check(holds(a, 64, 1), "the outer scope's object survived the inner rewind");
+
+        auto* d = resource.allocate(64);
+        check(d == inner_first, "the memory of the inner scope is handed out again");
+
+        resource.deallocate(d, 64);
+        resource.deallocate(a, 64);
+    }
+
+    check_empty(resource);
+}
+
+// Requests the reserved block cannot hold are served from the other unused blocks. rewind()
+// leaves that memory alone, so it must be deallocated like any other allocation.
+auto test_spilled_allocations_must_be_deallocated(ie::allocation_strategy _strategy) -> void
+{
+    constexpr std::size_t spilled_size = 30 * 1024;
+
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    // Leaves an unused block in front of "keep" that is larger than the last block.
+    auto* front = resource.allocate(40 * 1024);
+    auto* keep = resource.allocate(1024);
+    resource.deallocate(front, 40 * 1024);
+
+    const auto allocated = resource.allocated();
+    void* spilled = nullptr;
+
+    {
+        ie::checkpoint_guard guard{resource};
+
+        spilled = resource.allocate(spilled_size);
+        fill(spilled, spilled_size, 7);
+
+        check(spilled < keep, "the request was served from the block in front");
+        check(resource.is_consistent(), "the resource is consistent inside the scope");
+    }
+
+    check(resource.allocated() == allocated + spilled_size, "rewind() did not release the spilled memory");
+    check(holds(spilled, spilled_size, 7), "the spilled memory was not touched");
+    check(resource.is_consistent(), "the resource is consistent after the rewind");
+
+    resource.deallocate(spilled, spilled_size);
+    resource.deallocate(keep, 1024);
+    check_empty(resource);
+}
+
+// Deallocating the block in front of the reserved block leaves an unused block behind, which
+// the outermost rewind() merges with the released memory.
+auto test_rewind_merges_with_previous_block(ie::allocation_strategy _strategy) -> void
+{
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size()), _strategy};
+
+    auto* a = resource.allocate(1000);
+
+    {
+        ie::checkpoint_guard guard{resource};
+
+        auto* p = resource.allocate(100);
+        resource.deallocate(a, 1000);
+        resource.deallocate(p, 100);
+
+        check(resource.free_block_count() == 1, "the block in front of the reserved block is unused");
+        check(resource.is_consistent(), "the resource is consistent inside the scope");
+    }
+
+    check_empty(resource);
+}
+
+// Debug builds catch objects that outlive their checkpoint, and the deallocation of objects
+// that were rewound.
+auto test_rewind_detects_misuse() -> void
+{
+#ifndef NDEBUG
+    std::vector<std::byte> buffer(64 * 1024);
+    ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+    check(ie::test::aborts([&resource] {
+              auto checkpoint = resource.checkpoint();
+              resource.allocate(64);
+              resource.rewind(checkpoint);
+          }),
+          "rewinding while an object is alive asserts");
+
+    check(!ie::test::aborts([&resource] {
+              auto outer = resource.checkpoint();
+              auto* p = resource.allocate(64);
+              auto inner = resource.checkpoint();
+              resource.deallocate(p, 64);
+              resource.rewind(inner);
+              resource.rewind(outer);
+          }),
+          "an object of an enclosing scope may be deallocated inside a nested scope");
+
+    void* first = nullptr;
+    void* second = nullptr;
+
+    {
+        ie::checkpoint_guard guard{resource};
+
+        first = resource.allocate(64);
+        second = resource.allocate(64);
+        resource.deallocate(second, 64);
+        resource.deallocate(first, 64);
+    }
+
+    check(ie::test::aborts([&resource, first] { resource.deallocate(first, 64); }),
+          "deallocating the first rewound object asserts");
+    check(ie::test::aborts([&resource, second] { resource.deallocate(second, 64); }),
+          "deallocating a later rewound object asserts");
+
+    check_empty(resource);
+#endif // NDEBUG
+}
+
+using strategy_test = auto (*)(ie::allocation_strategy) -> void;
+
+// Adds one test case per allocation strategy.
+auto add_for_each_strategy(std::vector<ie::test::test_case>& _tests, const std::string& _name, strategy_test _test) -> void
+{
+    for (auto strategy : strategies) {
+        _tests.push_back({fmt::format("{}({})", _name, to_string(strategy)), [_test, strategy] { _test(strategy); }});
+    }
+}
+
 int main()
 {
     constexpr std::size_t max_size = 100000000;
@@ -494,16 +1157,36 @@ int main()
     }
 
     std::vector<std::byte> buffer(max_size);
-    irods::experimental::pmr::fixed_buffer_resource fbr(buffer.data(), buffer.size());
-    do_test(fbr);
 
-    //pmr::unsynchronized_pool_resource uspr{&fbr};
-    //do_test(uspr);
+    for (auto strategy : strategies) {
+        irods::experimental::pmr::fixed_buffer_resource fbr(buffer.data(), buffer.size(), strategy);
+        do_test(fbr);
+
+        //pmr::unsynchronized_pool_resource uspr{&fbr};
+        //do_test(uspr);
 
-    std::cout << "\nPost Test:\n";
-    std::cout << "  total memory allocated   : " << fbr.allocated() << '\n';
-    std::cout << "  total allocation overhead: " << fbr.allocation_overhead() << '\n';
+        std::cout << "\nPost Test (" << to_string(strategy) << "):\n";
+        std::cout << "  total memory allocated   : " << fbr.allocated() << '\n';
+        std::cout << "  total allocation overhead: " << fbr.allocation_overhead() << "\n\n";
+    }
 
-    return 0;
+    std::vector<ie::test::test_case> tests;
+
+    add_for_each_strategy(tests, "churn_keeps_resource_consistent", test_churn_keeps_resource_consistent);
+    add_for_each_strategy(tests, "exhaustion_and_recovery", test_exhaustion_and_recovery);
+    add_for_each_strategy(tests, "alignment_is_honored", test_alignment_is_honored);
+    add_for_each_strategy(tests, "tail_allocation", test_tail_allocation);
+    add_for_each_strategy(tests, "try_expand_grows_in_place", test_try_expand_grows_in_place);
+    add_for_each_strategy(tests, "shrink_in_place_releases_memory", test_shrink_in_place_releases_memory);
+    add_for_each_strategy(tests, "expanding_vector_grows_in_place", test_expanding_vector_grows_in_place);
+    add_for_each_strategy(tests, "bulk_allocation", test_bulk_allocation);
+    add_for_each_strategy(tests, "bulk_allocation_failure_changes_nothing", test_bulk_allocation_failure_changes_nothing);
+    add_for_each_strategy(tests, "rewind_restores_state", test_rewind_restores_state);
+    add_for_each_strategy(tests, "nested_checkpoints", test_nested_checkpoints);
+    add_for_each_strategy(tests, "spilled_allocations_must_be_deallocated", test_spilled_allocations_must_be_deallocated);
+    add_for_each_strategy(tests, "rewind_merges_with_previous_block", test_rewind_merges_with_previous_block);
+    tests.push_back({"rewind_detects_misuse", test_rewind_detects_misuse});
+
+    return ie::test::run(tests);
 }
 
@@ -0,0 +1,398 @@
+// Stresses memory resources with randomized allocation and deallocation churn under a fixed
+// cap, to measure how they cope with fragmentation.
+//
+// Usage: fragmentation_benchmark [--operations N] [--sizes uniform|log|bimodal]
+//                                [--min-bytes N] [--max-bytes N] [--mean-lifetime N]
+//                                [--long-lived PERCENT] [--warmup N] [--repetitions N]
+//                                [--max-size BYTES] [--seed N] [--filter SUBSTRING]
+//                                [--format table|csv|json]
+//
+// A schedule of --operations allocations is generated before any timing starts. Request sizes
+// are drawn from --sizes between --min-bytes and --max-bytes:
+//
+//   uniform  Every size is equally likely.
+//   log      Every power of two is equally likely, so small requests dominate.
+//   bimodal  90% of the requests are at most 8 * --min-bytes, the rest at least
+//            --max-bytes / 8.
+//
+// Each allocation lives for an exponentially distributed number of subsequent allocations
+// (--mean-lifetime on average), except for --long-lived percent of them, which are never
+// freed. Frees are interleaved with the allocations in the order the objects die.
+//
+// Each repetition builds a fresh resource stack capped at --max-size bytes and runs the whole
+// schedule. A failed allocation is counted and its free is skipped. The report shows the
+// throughput, the first allocation that failed together with the number of requested bytes
+// that were live at that moment, and the peak footprint of the stack (measured in an extra,
+// untimed run). A resource that fails while the live bytes are far below the cap is losing
+// the rest of the buffer to fragmentation.
+
+#include "benchmark_support.hpp"
+#include "buddy_buffer_resource.hpp"
+#include "capped_pool_resource.hpp"
+#include "fixed_buffer_resource.hpp"
+#include "slab_resource.hpp"
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/unsynchronized_pool_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+namespace bench = irods::experimental::pmr::bench;
+
+struct options
+{
+    std::size_t operations = 100'000;
+    std::string sizes = "log";
+    std::size_t min_bytes = 16;
+    std::size_t max_bytes = 16'384;
+    std::size_t mean_lifetime = 15'000;
+    double long_lived = 4;
+    std::size_t warmup = 1;
+    std::size_t repetitions = 3;
+    std::size_t max_size = 50'000'000;
+    std::uint32_t seed = 1;
+    std::string filter;
+    bench::output_format format = bench::output_format::table;
+};
+
+// A single step of the schedule. Objects are numbered in the order they are allocated.
+struct operation
+{
+    bool allocate;
+    std::uint32_t object;
+    std::uint32_t bytes;
+};
+
+// Returns the number of bytes the stack currently draws from its buffer.
+using usage_probe = std::function<std::size_t()>;
+
+// Constructs a resource stack capped at the buffer size, hands the top of the stack (and a
+// probe, if the stack has one) to the callback and tears the stack down again. Construction
+// and destruction are not timed.
+using stack_factory = std::function<void(const std::function<void(pmr::memory_resource&, const usage_probe&)>&)>;
+
+struct benchmark_case
+{
+    std::string name;
+    stack_factory make_stack;
+};
+
+struct run_result
+{
+    double ms;
+    std::size_t failed_allocations;
+    std::optional<std::size_t> first_failure;
+    std::size_t live_at_first_failure;
+    std::size_t peak_footprint;
+};
+
+auto parse_options(int _argc, char** _argv) -> options
+{
+    options opts;
+
+    for (int i = 1; i < _argc; ++i) {
+        const std::string_view arg = _argv[i];
+
+        if (i + 1 >= _argc) {
+            throw std::invalid_argument{fmt::format("missing value for option [{}]", arg)};
+        }
+
+        const std::string value = _argv[++i];
+
+        if      (arg == "--operations")    { opts.operations = std::stoul(value); }
+        else if (arg == "--sizes")         { opts.sizes = value; }
+        else if (arg == "--min-bytes")     { opts.min_bytes = std::stoul(value); }
+        else if (arg == "--max-bytes")     { opts.max_bytes = std::stoul(value); }
+        else if (arg == "--mean-lifetime") { opts.mean_lifetime = std::stoul(value); }
+        else if (arg == "--long-lived")    { opts.long_lived = std::stod(value); }
+        else if (arg == "--warmup")        { opts.warmup = std::stoul(value); }
+        else if (arg == "--repetitions")   { opts.repetitions = std::stoul(value); }
+        else if (arg == "--max-size")      { opts.max_size = std::stoul(value); }
+        else if (arg == "--seed")          { opts.seed = static_cast<std::uint32_t>(std::stoul(value)); }
+        else if (arg == "--filter")        { opts.filter = value; }
+        else if (arg == "--format")        { opts.format = bench::to_output_format(value); }
+        else {
+            throw std::invalid_argument{fmt::format("unknown option [{}]", arg)};
+        }
+    }
+
+    if (opts.sizes != "uniform" && opts.sizes != "log" && opts.sizes != "bimodal") {
+        throw std::invalid_argument{fmt::format("unknown size distribution [{}]", opts.sizes)};
+    }
+
+    if (opts.min_bytes == 0 || opts.min_bytes > opts.max_bytes || opts.max_bytes > UINT32_MAX) {
+        throw std::invalid_argument{"--min-bytes and --max-bytes must satisfy 0 < min <= max < 2^32"};
+    }
+
+    if (opts.operations > UINT32_MAX) {
+        throw std::invalid_argument{"--operations must be less than 2^32"};
+    }
+
+    if (opts.mean_lifetime == 0) {
+        throw std::invalid_argument{"--mean-lifetime must be greater than zero"};
+    }
+
+    if (opts.repetitions == 0) {
+        throw std::invalid_argument{"--repetitions must be greater than zero"};
+    }
+
+    return opts;
+}
+
+// Returns a function drawing request sizes from the distribution selected by the options.
+auto make_size_distribution(const options& _opts) -> std::function<std::size_t(std::mt19937&)>
+{
+    const auto lo = static_cast<double>(_opts.min_bytes);
+    const auto hi = static_cast<double>(_opts.max_bytes);
+
+    if (_opts.sizes == "uniform") {
+        return [d = std::uniform_int_distribution<std::size_t>{_opts.min_bytes, _opts.max_bytes}](auto& _gen) mutable {
+            return d(_gen);
+        };
+    }
+
+    if (_opts.sizes == "log") {
+        return [d = std::uniform_real_distribution<double>{std::log2(lo), std::log2(hi)}](auto& _gen) mutable {
+            return static_cast<std::size_t>(std::exp2(d(_gen)));
+        };
+    }
+
+    return [small = std::uniform_real_distribution<double>{lo, std::min(hi, lo * 8)},
+            large = std::uniform_real_distribution<double>{std::max(lo, hi / 8), hi},
+            pick = std::bernoulli_distribution{0.9}](auto& _gen) mutable {
+        return static_cast<std::size_t>(pick(_gen) ? small(_gen) : large(_gen));
+    };
+}
+
+auto generate_schedule(const options& _opts) -> std::vector<operation>
+{
+    std::mt19937 gen{_opts.seed};
+    auto next_size = make_size_distribution(_opts);
+    std::exponential_distribution<double> lifetime{1.0 / static_cast<double>(_opts.mean_lifetime)};
+    std::bernoulli_distribution long_lived{std::clamp(_opts.long_lived / 100.0, 0.0, 1.0)};
+
+    // (time of death, object, size), earliest death first.
+    using death = std::tuple<std::uint64_t, std::uint32_t, std::uint32_t>;
+    std::priority_queue<death, std::vector<death>, std::greater<>> deaths;
+
+    std::vector<operation> schedule;
+    schedule.reserve(2 * _opts.operations);
+
+    for (std::uint32_t i = 0; i < _opts.operations; ++i) {
+        while (!deaths.empty() && std::get<0>(deaths.top()) <= i) {
+            const auto [when, object, bytes] = deaths.top();
+            schedule.push_back({false, object, bytes});
+            deaths.pop();
+        }
+
+        const auto bytes = static_cast<std::uint32_t>(next_size(gen));
+        schedule.push_back({true, i, bytes});
+
+        if (!long_lived(gen)) {
+            deaths.emplace(i + 1 + static_cast<std::uint64_t>(lifetime(gen)), i, bytes);
+        }
+    }
+
+    return schedule;
+}
+
+// Runs the schedule against the resource. "_live" maps objects to addresses and must have room
+// for every object. If "_probe" is set, it is called after every allocation and the largest
+// value is reported.
+auto run_once(pmr::memory_resource& _resource,
+              const std::vector<operation>& _schedule,
+              std::vector<void*>& _live,
+              const usage_probe& _probe = {}) -> run_result
+{
+    std::fill(std::begin(_live), std::end(_live), nullptr);
+
+    run_result result{};
+    std::size_t allocations = 0;
+    std::size_t live_bytes = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& op : _schedule) {
+        if (op.allocate) {
+            ++allocations;
+
+            try {
+                _live[op.object] = _resource.allocate(op.bytes);
+            }
+            catch (const std::bad_alloc&) {
+                if (++result.failed_allocations == 1) {
+                    result.first_failure = allocations;
+                    result.live_at_first_failure = live_bytes;
+                }
+
+                continue;
+            }
+
+            live_bytes += op.bytes;
+
+            if (_probe) {
+                result.peak_footprint = std::max(result.peak_footprint, _probe());
+            }
+        }
+        else if (auto*& p = _live[op.object]; p) {
+            _resource.deallocate(p, op.bytes);
+            live_bytes -= op.bytes;
+            p = nullptr;
+        }
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Long-lived objects are freed after the timed loop. Their sizes are in the schedule.
+    for (const auto& op : _schedule) {
+        if (op.allocate && _live[op.object]) {
+            _resource.deallocate(_live[op.object], op.bytes);
+            _live[op.object] = nullptr;
+        }
+    }
+
+    result.ms = std::chrono::duration<double, std::milli>(elapsed).count();
+
+    return result;
+}
+
+auto make_cases(std::byte* _buffer, std::size_t _buffer_size) -> std::vector<benchmark_case>
+{
+    const auto size = static_cast<std::int64_t>(_buffer_size);
+
+    const auto fbr_case = [_buffer, size](ie::allocation_strategy _strategy) -> stack_factory {
+        return [_buffer, size, _strategy](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, _strategy};
+            _run(fbr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        };
+    };
+
+    // The layered stacks use the two-level segregated fit strategy. Under first fit, every
+    // request the upper layer passes down walks thousands of live blocks.
+    return {
+        {"capped_memory_pool", [size](const auto& _run) {
+            bench::capped_memory_pool cmp{size};
+            _run(cmp, [&cmp] { return cmp.allocated(); });
+        }},
+        {"fixed_buffer_resource(first_fit)", fbr_case(ie::allocation_strategy::first_fit)},
+        {"fixed_buffer_resource(segregated_fit)", fbr_case(ie::allocation_strategy::segregated_fit)},
+        {"fixed_buffer_resource(two_level_segregated_fit)", fbr_case(ie::allocation_strategy::two_level_segregated_fit)},
+        {"buddy_buffer_resource", [_buffer, size](const auto& _run) {
+            ie::buddy_buffer_resource bbr{_buffer, size};
+            _run(bbr, [&bbr] { return bbr.allocated() + bbr.allocation_overhead(); });
+        }},
+        {"unsynchronized_pool_resource/fixed_buffer_resource(two_level_segregated_fit)", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, ie::allocation_strategy::two_level_segregated_fit};
+            pmr::unsynchronized_pool_resource upr{&fbr};
+            _run(upr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        }},
+        {"slab_resource/fixed_buffer_resource(two_level_segregated_fit)", [_buffer, size](const auto& _run) {
+            ie::fixed_buffer_resource fbr{_buffer, size, ie::allocation_strategy::two_level_segregated_fit};
+            ie::slab_resource sr{&fbr};
+            _run(sr, [&fbr] { return fbr.allocated() + fbr.allocation_overhead(); });
+        }},
+        {"capped_pool_resource", [_buffer, size](const auto& _run) {
+            ie::capped_pool_resource<std::byte> cpr{_buffer, size};
+            _run(cpr, [&cpr] { return cpr.statistics().buffer_in_use; });
+        }},
+    };
+}
+
+int main(int _argc, char** _argv)
+{
+    try {
+        const auto opts = parse_options(_argc, _argv);
+        const auto schedule = generate_schedule(opts);
+
+        std::size_t live_bytes = 0;
+        std::size_t peak_live_bytes = 0;
+
+        for (const auto& op : schedule) {
+            if (op.allocate) {
+                peak_live_bytes = std::max(peak_live_bytes, live_bytes += op.bytes);
+            }
+            else {
+                live_bytes -= op.bytes;
+            }
+        }
+
+        std::cerr << fmt::format("schedule: {} operations, {} bytes live at peak ({:.1f}% of the cap)\n",
+                                 schedule.size(),
+                                 peak_live_bytes,
+                                 100.0 * peak_live_bytes / opts.max_size);
+
+        std::vector<std::byte> buffer(opts.max_size);
+        std::vector<void*> live(opts.operations);
+        bench::report report;
+
+        for (const auto& c : make_cases(buffer.data(), opts.max_size)) {
+            if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) {
+                continue;
+            }
+
+            std::vector<double> samples;
+            run_result last{};
+
+            for (std::size_t i = 0; i < opts.warmup + opts.repetitions; ++i) {
+                c.make_stack([&](pmr::memory_resource& _resource, const usage_probe&) {
+                    const auto result = run_once(_resource, schedule, live);
+
+                    if (i >= opts.warmup) {
+                        samples.push_back(result.ms);
+                        last = result;
+                    }
+                });
+            }
+
+            std::size_t peak_footprint = 0;
+
+            c.make_stack([&](pmr::memory_resource& _resource, const usage_probe& _probe) {
+                peak_footprint = run_once(_resource, schedule, live, _probe).peak_footprint;
+            });
+
+            const auto s = bench::summarize(samples);
+            const auto failed = last.first_failure.has_value();
+
+            report.add({bench::text("resource", c.name),
+                        bench::number("operations", schedule.size()),
+                        bench::number("repetitions", s.samples),
+                        bench::number("median_ms", s.p50),
+                        bench::number("p90_ms", s.p90),
+                        bench::number("mops_per_second", s.p50 > 0 ? schedule.size() / s.p50 / 1e3 : 0.0),
+                        bench::number("peak_footprint", peak_footprint),
+                        bench::number("failed_allocations", last.failed_allocations),
+                        failed ? bench::number("first_bad_alloc", *last.first_failure) : bench::text("first_bad_alloc", "-"),
+                        failed ? bench::number("live_at_first_bad_alloc", last.live_at_first_failure)
+                               : bench::text("live_at_first_bad_alloc", "-")});
+        }
+
+        report.write(std::cout, opts.format);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,409 @@
+#ifndef IRODS_INSTRUMENTED_RESOURCE_HPP
+#define IRODS_INSTRUMENTED_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace irods::experimental::pmr
+{
+    /// A \p latency_histogram counts durations (in nanoseconds) in log-linear buckets.
+    ///
+    /// Values below \p 2^sub_bucket_bits are counted exactly. Larger values are grouped by
+    /// their most significant bit, and each of those power-of-two ranges is split into
+    /// \p 2^sub_bucket_bits linear buckets, which bounds the relative error of every reported
+    /// value to 1 / 2^sub_bucket_bits. Recording a value is a handful of integer operations and
+    /// never allocates.
+    ///
+    /// \since 4.2.11
+    class latency_histogram
+    {
+    public:
+        /// The number of bits used to subdivide each power-of-two range.
+        static constexpr std::size_t sub_bucket_bits = 4;
+
+        /// Values at or above \p 2^max_value_bits nanoseconds (roughly 68 seconds) are clamped.
+        static constexpr std::size_t max_value_bits = 36;
+
+        /// Records a single duration.
+        ///
+        /// \since 4.2.11
+        auto record(std::uint64_t _nanoseconds) noexcept -> void
+        {
+            ++counts_[bucket_of(_nanoseconds)];
+            ++count_;
+            max_ = std::max(max_, _nanoseconds);
+        } // record
+
+        /// Adds the counts of another histogram to this one.
+        ///
+        /// \since 4.2.11
+        auto merge(const latency_histogram& _other) noexcept -> void
+        {
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                counts_[i] += _other.counts_[i];
+            }
+
+            count_ += _other.count_;
+            max_ = std::max(max_, _other.max_);
+        } // merge
+
+        /// Returns the number of durations recorded.
+        ///
+        /// \since 4.2.11
+        auto count() const noexcept -> std::uint64_t
+        {
+            return count_;
+        } // count
+
+        /// Returns the largest duration recorded (exact).
+        ///
+        /// \since 4.2.11
+        auto max() const noexcept -> std::uint64_t
+        {
+            return max_;
+        } // max
+
+        /// Returns an upper bound for the duration below which \p _percentile percent (0-100)
+        /// of the recorded durations fall, or zero if nothing has been recorded.
+        ///
+        /// \since 4.2.11
+        auto percentile(double _percentile) const noexcept -> std::uint64_t
+        {
+            if (count_ == 0) {
+                return 0;
+            }
+
+            const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(_percentile / 100.0 * count_)));
+            std::uint64_t seen = 0;
+
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                if (seen += counts_[i]; seen >= rank) {
+                    return std::min(upper_bound_of(i), max_);
+                }
+            }
+
+            return max_;
+        } // percentile
+
+        /// Discards every recorded duration.
+        ///
+        /// \since 4.2.11
+        auto reset() noexcept -> void
+        {
+            counts_.fill(0);
+            count_ = 0;
+            max_ = 0;
+        } // reset
+
+    private:
+        static constexpr std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+        static constexpr std::size_t bucket_count = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+        static auto bucket_of(std::uint64_t _value) noexcept -> std::size_t
+        {
+            _value = std::min(_value, (std::uint64_t{1} << max_value_bits) - 1);
+
+            if (_value < sub_bucket_count) {
+                return static_cast<std::size_t>(_value);
+            }
+
+#if defined(__GNUC__) || defined(__clang__)
+            const auto msb = static_cast<std::size_t>(sizeof(std::uint64_t) * CHAR_BIT - 1 - __builtin_clzll(_value));
+#else
+            std::size_t msb = 0;
+            for (auto v = _value; v >>= 1;) {
+                ++msb;
+            }
+#endif
+            const auto range = msb - sub_bucket_bits + 1;
+            const auto sub = static_cast<std::size_t>(_value >> (msb - sub_bucket_bits)) & (sub_bucket_count - 1);
+
+            return range * sub_bucket_count + sub;
+        } // bucket_of
+
+        // Returns the largest value that maps to bucket "_index".
+        static auto upper_bound_of(std::size_t _index) noexcept -> std::uint64_t
+        {
+            if (_index < sub_bucket_count) {
+                return _index;
+            }
+
+            const auto range = _index / sub_bucket_count;
+            const auto sub = _index % sub_bucket_count;
+            const auto shift = range - 1;
+
+            return ((std::uint64_t{sub_bucket_count + sub + 1}) << shift) - 1;
+        } // upper_bound_of
+
+        std::array<std::uint64_t, bucket_count> counts_{};
+        std::uint64_t count_{};
+        std::uint64_t max_{};
+    }; // class latency_histogram
+
+    /// An \p instrumented_resource is a memory resource decorator that measures how long the
+    /// upstream resource takes to allocate and deallocate memory. Latencies are recorded in
+    /// \p latency_histogram objects, separately for each power-of-two size class, so that tail
+    /// latencies (e.g. a long first-fit walk in \p fixed_buffer_resource) are not hidden by
+    /// averages.
+    ///
+    /// Each operation adds two reads of \p std::chrono::steady_clock and a histogram update.
+    ///
+    /// This class is NOT thread-safe. Wrap each thread's resource separately when measuring
+    /// thread-safe resources.
+    ///
+    /// \since 4.2.11
+    class instrumented_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Requests of up to \p 2^(i+3) bytes fall into size class \p i. Everything larger than
+        /// the last power-of-two class falls into the final class.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t size_class_count = 19;
+
+        /// Constructs an \p instrumented_resource.
+        ///
+        /// \param[in] _upstream The resource being measured.
+        ///
+        /// \throws std::invalid_argument If \p _upstream is null.
+        ///
+        /// \since 4.2.11
+        explicit instrumented_resource(boost::container::pmr::memory_resource* _upstream)
+            : boost::container::pmr::memory_resource{}
+            , upstream_{_upstream}
+            , allocate_latencies_(size_class_count)
+            , deallocate_latencies_(size_class_count)
+            , failed_allocations_{}
+            , live_allocations_{}
+            , peak_allocations_{}
+        {
+            if (!_upstream) {
+                throw std::invalid_argument{"instrumented_resource: upstream resource is null."};
+            }
+        } // instrumented_resource
+
+        instrumented_resource(const instrumented_resource&) = delete;
+        auto operator=(const instrumented_resource&) -> instrumented_resource& = delete;
+
+        ~instrumented_resource() = default;
+
+        /// Returns the size class a request of \p _bytes bytes is recorded under.
+        ///
+        /// \since 4.2.11
+        static auto size_class_of(std::size_t _bytes) noexcept -> std::size_t
+        {
+            std::size_t i = 0;
+
+            while (i + 1 < size_class_count && (std::size_t{8} << i) < _bytes) {
+                ++i;
+            }
+
+            return i;
+        } // size_class_of
+
+        /// Returns the largest request size recorded under size class \p _class, or zero for
+        /// the final, unbounded class.
+        ///
+        /// \since 4.2.11
+        static auto size_class_limit(std::size_t _class) noexcept -> std::size_t
+        {
+            return _class + 1 < size_class_count ? std::size_t{8} << _class : 0;
+        } // size_class_limit
+
+        /// Returns the allocation latencies recorded for size class \p _class.
+        ///
+        /// \since 4.2.11
+        auto allocate_latencies(std::size_t _class) const -> const latency_histogram&
+        {
+            return allocate_latencies_.at(_class);
+        } // allocate_latencies
+
+        /// Returns the allocation latencies of all size classes combined.
+        ///
+        /// \since 4.2.11
+        auto allocate_latencies() const -> latency_histogram
+        {
+            return combine(allocate_latencies_);
+        } // allocate_latencies
+
+        /// Returns the deallocation latencies recorded for size class \p _class.
+        ///
+        /// \since 4.2.11
+        auto deallocate_latencies(std::size_t _class) const -> const latency_histogram&
+        {
+            return deallocate_latencies_.at(_class);
+        } // deallocate_latencies
+
+        /// Returns the deallocation latencies of all size classes combined.
+        ///
+        /// \since 4.2.11
+        auto deallocate_latencies() const -> latency_histogram
+        {
+            return combine(deallocate_latencies_);
+        } // deallocate_latencies
+
+        /// Returns the number of allocations of size class \p _class that have not been
+        /// deallocated yet.
+        ///
+        /// \since 4.2.11
+        auto live_allocations(std::size_t _class) const -> std::uint64_t
+        {
+            return live_allocations_.at(_class);
+        } // live_allocations
+
+        /// Returns the largest number of allocations of size class \p _class that were live at
+        /// the same time.
+        ///
+        /// \since 4.2.11
+        auto peak_allocations(std::size_t _class) const -> std::uint64_t
+        {
+            return peak_allocations_.at(_class);
+        } // peak_allocations
+
+        /// Returns the number of requests the upstream resource failed to satisfy.
+        ///
+        /// \since 4.2.11
+        auto failed_allocations() const noexcept -> std::uint64_t
+        {
+            return failed_allocations_;
+        } // failed_allocations
+
+        /// Discards every recorded latency. Peaks restart from the number of live allocations.
+        ///
+        /// \since 4.2.11
+        auto reset() noexcept -> void
+        {
+            peak_allocations_ = live_allocations_;
+
+            for (auto& h : allocate_latencies_) {
+                h.reset();
+            }
+
+            for (auto& h : deallocate_latencies_) {
+                h.reset();
+            }
+
+            failed_allocations_ = 0;
+        } // reset
+
+        /// Writes the p50/p99/p999/max latencies (in nanoseconds) of every non-empty size class
+        /// to the output stream.
+        ///
+        /// \since 4.2.11
+        auto print(std::ostream& _os) const -> void
+        {
+            const auto print_row = [&_os](const char* _op, const std::string& _sizes, const latency_histogram& _h) {
+                if (_h.count() == 0) {
+                    return;
+                }
+
+                _os << fmt::format("{:<10} {:>12} {{count={}, p50={}ns, p99={}ns, p999={}ns, max={}ns}}\n",
+                                   _op,
+                                   _sizes,
+                                   _h.count(),
+                                   _h.percentile(50),
+                                   _h.percentile(99),
+                                   _h.percentile(99.9),
+                                   _h.max());
+            };
+
+            for (std::size_t i = 0; i < size_class_count; ++i) {
+                const auto limit = size_class_limit(i);
+                const auto sizes = limit ? fmt::format("<= {}", limit) : fmt::format("> {}", size_class_limit(i - 1));
+
+                print_row("allocate", sizes, allocate_latencies_[i]);
+                print_row("deallocate", sizes, deallocate_latencies_[i]);
+            }
+
+            print_row("allocate", "all", allocate_latencies());
+            print_row("deallocate", "all", deallocate_latencies());
+
+            if (failed_allocations_ > 0) {
+                _os << fmt::format("failed allocations: {}\n", failed_allocations_);
+            }
+        } // print
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            const auto start = clock_type::now();
+
+            try {
+                auto* p = upstream_->allocate(_bytes, _alignment);
+                const auto i = size_class_of(_bytes);
+
+                allocate_latencies_[i].record(elapsed_since(start));
+                peak_allocations_[i] = std::max(peak_allocations_[i], ++live_allocations_[i]);
+
+                return p;
+            }
+            catch (...) {
+                ++failed_allocations_;
+                throw;
+            }
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            const auto start = clock_type::now();
+            upstream_->deallocate(_p, _bytes, _alignment);
+
+            const auto i = size_class_of(_bytes);
+
+            deallocate_latencies_[i].record(elapsed_since(start));
+            --live_allocations_[i];
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        using clock_type = std::chrono::steady_clock;
+
+        static auto elapsed_since(clock_type::time_point _start) noexcept -> std::uint64_t
+        {
+            const auto elapsed = clock_type::now() - _start;
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        } // elapsed_since
+
+        static auto combine(const std::vector<latency_histogram>& _histograms) -> latency_histogram
+        {
+            latency_histogram h;
+
+            for (const auto& e : _histograms) {
+                h.merge(e);
+            }
+
+            return h;
+        } // combine
+
+        boost::container::pmr::memory_resource* upstream_;
+        std::vector<latency_histogram> allocate_latencies_;
+        std::vector<latency_histogram> deallocate_latencies_;
+        std::uint64_t failed_allocations_;
+        std::array<std::uint64_t, size_class_count> live_allocations_;
+        std::array<std::uint64_t, size_class_count> peak_allocations_;
+    }; // instrumented_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_INSTRUMENTED_RESOURCE_HPP
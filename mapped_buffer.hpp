@@ -0,0 +1,415 @@
+#ifndef IRODS_MAPPED_BUFFER_HPP
+#define IRODS_MAPPED_BUFFER_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+
+#include <fmt/format.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace irods::experimental::pmr
+{
+    /// Defines the kinds of pages a \p mapped_buffer can be backed by.
+    ///
+    /// \since 4.2.11
+    enum class page_policy
+    {
+        /// Regular pages.
+        default_pages,
+
+        /// Regular pages with a hint asking the kernel to back the buffer with transparent
+        /// huge pages (THP).
+        transparent_huge_pages,
+
+        /// Pages from the pool of explicitly reserved huge pages (MAP_HUGETLB). Falls back to
+        /// \p transparent_huge_pages if the pool cannot satisfy the request.
+        huge_pages
+    }; // enum class page_policy
+
+    /// Defines when the memory of a \p mapped_buffer is committed.
+    ///
+    /// \since 4.2.11
+    enum class commit_policy
+    {
+        /// Pages are committed (and zeroed) by the kernel on first touch.
+        on_demand,
+
+        /// Every page is committed before the constructor returns (MAP_POPULATE).
+        immediate
+    }; // enum class commit_policy
+
+    /// Defines how memory returned to the kernel by a \p mapped_buffer is reclaimed.
+    ///
+    /// \since 4.2.11
+    enum class release_policy
+    {
+        /// The pages are dropped right away (MADV_DONTNEED). Resident memory shrinks
+        /// immediately and the pages read back as zeros.
+        immediate,
+
+        /// The kernel may reclaim the pages whenever it is under memory pressure (MADV_FREE).
+        /// Cheaper if the memory is reused soon, but resident memory does not shrink until the
+        /// pages are actually reclaimed. Falls back to \p immediate where unsupported.
+        lazy
+    }; // enum class release_policy
+
+    /// A \p mapped_buffer is a buffer backed by a memory mapping, intended as the allocation
+    /// source of a \p fixed_buffer_resource. The mapping is either anonymous and private, or a
+    /// shared mapping of a file, POSIX shared memory object or memfd.
+    ///
+    /// Unlike a \p std::vector<std::byte>, creating a large \p mapped_buffer does not touch
+    /// its memory, so startup time and resident memory only grow with the part of the buffer
+    /// actually used. Memory given back to the resource can be returned to the kernel with
+    /// \p release_unused_memory.
+    ///
+    /// \since 4.2.11
+    class mapped_buffer
+    {
+    public:
+        /// The size of a huge page assumed when mapping with \p page_policy::huge_pages or
+        /// aligning for \p page_policy::transparent_huge_pages.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+        /// Maps a new buffer.
+        ///
+        /// \param[in] _size   The size of the buffer in bytes.
+        /// \param[in] _pages  The kinds of pages backing the buffer.
+        /// \param[in] _commit When the memory is committed.
+        ///
+        /// \throws std::invalid_argument If \p _size is zero.
+        /// \throws std::system_error     If the memory could not be mapped.
+        ///
+        /// \since 4.2.11
+        explicit mapped_buffer(std::size_t _size,
+                               page_policy _pages = page_policy::default_pages,
+                               commit_policy _commit = commit_policy::on_demand)
+            : data_{}
+            , size_{_size}
+            , mapping_{}
+            , mapping_size_{}
+            , pages_{_pages}
+            , page_size_{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))}
+            , shared_{}
+        {
+            if (_size == 0) {
+                throw std::invalid_argument{"mapped_buffer: invalid buffer size [size=0]."};
+            }
+
+            const int flags = MAP_PRIVATE | MAP_ANONYMOUS | (_commit == commit_policy::immediate ? MAP_POPULATE : 0);
+
+            if (_pages == page_policy::huge_pages) {
+                // Huge pages must be reserved up front. Without the reservation, the mapping
+                // succeeds even if the pool is empty and the first touch raises SIGBUS.
+                mapping_size_ = round_up(_size, huge_page_size);
+                mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+
+                if (mapping_ != MAP_FAILED) {
+                    data_ = static_cast<std::byte*>(mapping_);
+                    page_size_ = huge_page_size;
+                    return;
+                }
+
+                pages_ = page_policy::transparent_huge_pages;
+            }
+
+            if (pages_ == page_policy::transparent_huge_pages) {
+                // Over-map so that the buffer can start on a huge page boundary. Otherwise, the
+                // kernel could only use huge pages for the interior of the buffer.
+                mapping_size_ = round_up(_size, huge_page_size) + huge_page_size;
+            }
+            else {
+                mapping_size_ = round_up(_size, page_size_);
+            }
+
+            mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, flags | MAP_NORESERVE, -1, 0);
+
+            if (mapping_ == MAP_FAILED) {
+                const auto ec = errno;
+                mapping_ = nullptr;
+                throw std::system_error{ec, std::generic_category(), fmt::format("mapped_buffer: mmap failed [size={}]", _size)};
+            }
+
+            data_ = static_cast<std::byte*>(mapping_);
+
+            if (pages_ == page_policy::transparent_huge_pages) {
+                const auto address = reinterpret_cast<std::uintptr_t>(data_);
+                data_ += round_up(address, huge_page_size) - address;
+
+#ifdef MADV_HUGEPAGE
+                // Only a hint. Failure (e.g. THP disabled) leaves the buffer on regular pages.
+                ::madvise(data_, round_up(_size, huge_page_size), MADV_HUGEPAGE);
+#endif
+            }
+        } // mapped_buffer
+
+        /// Maps \p _size bytes of the file referred to by \p _fd (e.g. a regular file, POSIX
+        /// shared memory object or memfd). Writes are visible to every process mapping the same
+        /// file. The file must already be at least \p _offset + \p _size bytes long.
+        ///
+        /// \param[in] _fd     An open file descriptor with read and write access. The descriptor
+        ///                    may be closed once the constructor returns.
+        /// \param[in] _size   The size of the buffer in bytes.
+        /// \param[in] _offset The offset of the buffer within the file. Must be a multiple of
+        ///                    the page size.
+        ///
+        /// \throws std::invalid_argument If \p _size is zero.
+        /// \throws std::system_error     If the file could not be mapped.
+        ///
+        /// \since 4.2.11
+        mapped_buffer(int _fd, std::size_t _size, std::int64_t _offset = 0)
+            : data_{}
+            , size_{_size}
+            , mapping_{}
+            , mapping_size_{}
+            , pages_{page_policy::default_pages}
+            , page_size_{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))}
+            , shared_{true}
+        {
+            if (_size == 0) {
+                throw std::invalid_argument{"mapped_buffer: invalid buffer size [size=0]."};
+            }
+
+            mapping_size_ = round_up(_size, page_size_);
+            mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, _offset);
+
+            if (mapping_ == MAP_FAILED) {
+                const auto ec = errno;
+                mapping_ = nullptr;
+                const auto msg = fmt::format("mapped_buffer: mmap failed [fd={}, size={}, offset={}]", _fd, _size, _offset);
+                throw std::system_error{ec, std::generic_category(), msg};
+            }
+
+            data_ = static_cast<std::byte*>(mapping_);
+        } // mapped_buffer
+
+        mapped_buffer(mapped_buffer&& _other) noexcept
+            : data_{std::exchange(_other.data_, nullptr)}
+            , size_{std::exchange(_other.size_, 0)}
+            , mapping_{std::exchange(_other.mapping_, nullptr)}
+            , mapping_size_{std::exchange(_other.mapping_size_, 0)}
+            , pages_{_other.pages_}
+            , page_size_{_other.page_size_}
+            , shared_{_other.shared_}
+        {
+        } // mapped_buffer
+
+        auto operator=(mapped_buffer&& _other) noexcept -> mapped_buffer&
+        {
+            if (this != &_other) {
+                unmap();
+
+                data_ = std::exchange(_other.data_, nullptr);
+                size_ = std::exchange(_other.size_, 0);
+                mapping_ = std::exchange(_other.mapping_, nullptr);
+                mapping_size_ = std::exchange(_other.mapping_size_, 0);
+                pages_ = _other.pages_;
+                page_size_ = _other.page_size_;
+                shared_ = _other.shared_;
+            }
+
+            return *this;
+        } // operator=
+
+        mapped_buffer(const mapped_buffer&) = delete;
+        auto operator=(const mapped_buffer&) -> mapped_buffer& = delete;
+
+        ~mapped_buffer()
+        {
+            unmap();
+        } // ~mapped_buffer
+
+        /// Returns a pointer to the beginning of the buffer.
+        ///
+        /// \since 4.2.11
+        auto data() const noexcept -> std::byte*
+        {
+            return data_;
+        } // data
+
+        /// Returns the size of the buffer in bytes, as requested on construction.
+        ///
+        /// \since 4.2.11
+        auto size() const noexcept -> std::size_t
+        {
+            return size_;
+        } // size
+
+        /// Returns the kinds of pages the buffer was mapped with. This differs from the policy
+        /// requested on construction if huge pages were not available.
+        ///
+        /// \since 4.2.11
+        auto pages() const noexcept -> page_policy
+        {
+            return pages_;
+        } // pages
+
+        /// Returns whether the buffer is a shared mapping of a file.
+        ///
+        /// \since 4.2.11
+        auto is_shared() const noexcept -> bool
+        {
+            return shared_;
+        } // is_shared
+
+        /// Returns the granularity in which memory can be returned to the kernel.
+        ///
+        /// \since 4.2.11
+        auto page_size() const noexcept -> std::size_t
+        {
+            return page_size_;
+        } // page_size
+
+        /// Returns the whole pages within [\p _p, \p _p + \p _size) to the kernel. The memory
+        /// stays mapped and is committed again on the next touch. Partial pages at either end
+        /// are left alone.
+        ///
+        /// For anonymous mappings, the contents of the pages are lost. For shared mappings, only
+        /// this process' copy of the pages is dropped, and \p _policy is ignored.
+        ///
+        /// \param[in] _p      The beginning of the range. Must point into the buffer.
+        /// \param[in] _size   The size of the range in bytes.
+        /// \param[in] _policy How the pages are reclaimed.
+        ///
+        /// \return The number of bytes returned to the kernel.
+        ///
+        /// \since 4.2.11
+        auto release(void* _p, std::size_t _size, release_policy _policy = release_policy::immediate) noexcept
+            -> std::size_t
+        {
+            const auto begin = round_up(reinterpret_cast<std::uintptr_t>(_p), page_size_);
+            const auto end = round_down(reinterpret_cast<std::uintptr_t>(_p) + _size, page_size_);
+
+            if (begin >= end) {
+                return 0;
+            }
+
+            auto* p = reinterpret_cast<void*>(begin);
+            const auto length = end - begin;
+
+#ifdef MADV_FREE
+            // MADV_FREE is not supported for hugetlb mappings or by older kernels.
+            if (_policy == release_policy::lazy && !shared_ && pages_ != page_policy::huge_pages &&
+                ::madvise(p, length, MADV_FREE) == 0)
+            {
+                return length;
+            }
+#else
+            static_cast<void>(_policy);
+#endif
+
+            return ::madvise(p, length, MADV_DONTNEED) == 0 ? length : 0;
+        } // release
+
+        /// Asks the kernel to place the pages of the buffer on the given NUMA node. The node is
+        /// preferred, not required: pages go elsewhere when it runs out of memory.
+        ///
+        /// Only pages committed after the call are affected, so it should be called before the
+        /// buffer is touched (i.e. with \p commit_policy::on_demand). Not supported for shared
+        /// mappings.
+        ///
+        /// \param[in] _node The NUMA node.
+        ///
+        /// \return True if the policy was applied. False if the kernel does not support NUMA
+        ///         policies or \p _node does not exist.
+        ///
+        /// \since 4.2.11
+        auto prefer_node(int _node) noexcept -> bool
+        {
+#ifdef SYS_mbind
+            constexpr int mpol_preferred = 1; // From <linux/mempolicy.h>.
+            constexpr auto bits_per_word = sizeof(unsigned long) * CHAR_BIT;
+
+            if (shared_ || _node < 0 || static_cast<std::size_t>(_node) >= max_numa_nodes) {
+                return false;
+            }
+
+            unsigned long mask[max_numa_nodes / bits_per_word]{};
+            mask[_node / bits_per_word] = 1ul << (_node % bits_per_word);
+
+            return ::syscall(SYS_mbind, mapping_, mapping_size_, mpol_preferred, mask, max_numa_nodes + 1, 0) == 0;
+#else
+            static_cast<void>(_node);
+            return false;
+#endif
+        } // prefer_node
+
+    private:
+        // The number of nodes covered by the node mask passed to the kernel.
+        static constexpr std::size_t max_numa_nodes = 1024;
+
+        static constexpr auto round_up(std::uintptr_t _value, std::size_t _multiple) noexcept -> std::uintptr_t
+        {
+            return (_value + _multiple - 1) / _multiple * _multiple;
+        } // round_up
+
+        static constexpr auto round_down(std::uintptr_t _value, std::size_t _multiple) noexcept -> std::uintptr_t
+        {
+            return _value / _multiple * _multiple;
+        } // round_down
+
+        auto unmap() noexcept -> void
+        {
+            if (mapping_) {
+                ::munmap(mapping_, mapping_size_);
+                mapping_ = nullptr;
+            }
+        } // unmap
+
+        std::byte* data_;
+        std::size_t size_;
+        void* mapping_;
+        std::size_t mapping_size_;
+        page_policy pages_;
+        std::size_t page_size_;
+        bool shared_;
+    }; // class mapped_buffer
+
+    /// Returns the memory of the unused blocks of \p _resource to the kernel.
+    ///
+    /// Only blocks of at least \p _min_block_size bytes are considered, so that memory which
+    /// is likely to be reused soon is not released. The resource stays fully usable. Released
+    /// pages are committed again when the resource hands them out.
+    ///
+    /// \param[in] _resource       A \p fixed_buffer_resource (or a class derived from it)
+    ///                            whose buffer is \p _buffer. A \p shared_buffer_resource
+    ///                            holds its mutex while the blocks are released.
+    /// \param[in] _buffer         The buffer managed by \p _resource.
+    /// \param[in] _min_block_size The size of the smallest unused block considered.
+    /// \param[in] _policy         How the pages are reclaimed.
+    ///
+    /// \return The number of bytes returned to the kernel.
+    ///
+    /// \since 4.2.11
+    template <typename Resource>
+    auto release_unused_memory(const Resource& _resource,
+                               mapped_buffer& _buffer,
+                               std::size_t _min_block_size = mapped_buffer::huge_page_size,
+                               release_policy _policy = release_policy::immediate) -> std::size_t
+    {
+        std::size_t released = 0;
+
+        _resource.for_each_unused_block([&](void* _p, std::size_t _size) {
+            if (_size >= _min_block_size) {
+                released += _buffer.release(_p, _size, _policy);
+            }
+        });
+
+        return released;
+    } // release_unused_memory
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_MAPPED_BUFFER_HPP
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "fixed_buffer_resource.hpp"
+#include "mapped_buffer.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    constexpr std::size_t buffer_size = 8 * 1024 * 1024;
+
+    auto is_aligned(const void* _p, std::size_t _alignment) -> bool
+    {
+        return reinterpret_cast<std::uintptr_t>(_p) % _alignment == 0;
+    }
+
+    // Returns whether every page of [_p, _p + _size) is resident.
+    auto is_resident(const void* _p, std::size_t _size, std::size_t _page_size) -> bool
+    {
+        std::vector<unsigned char> pages((_size + _page_size - 1) / _page_size);
+
+        if (::mincore(const_cast<void*>(_p), _size, pages.data()) != 0) {
+            throw std::runtime_error{"mincore failed"};
+        }
+
+        return std::all_of(std::begin(pages), std::end(pages), [](auto _page) { return _page & 1; });
+    }
+
+    // Returns the number of huge pages reserved by the administrator.
+    auto reserved_huge_pages() -> long
+    {
+        std::ifstream in{"/proc/sys/vm/nr_hugepages"};
+        long n = 0;
+        return (in >> n) ? n : 0;
+    }
+
+    auto test_default_pages_are_writable() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size};
+
+        check(buffer.data() != nullptr && buffer.size() == buffer_size, "the buffer was mapped");
+        check(buffer.pages() == ie::page_policy::default_pages, "regular pages are used");
+        check(buffer.page_size() == static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)), "the page size is the system's");
+        check(!buffer.is_shared(), "an anonymous mapping is private");
+
+        std::fill(buffer.data(), buffer.data() + buffer.size(), std::byte{0x5a});
+        check(buffer.data()[buffer.size() - 1] == std::byte{0x5a}, "the whole buffer is writable");
+    }
+
+    auto test_invalid_size_is_rejected() -> void
+    {
+        bool rejected = false;
+
+        try {
+            ie::mapped_buffer buffer{0};
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+
+        check(rejected, "a zero-byte buffer was rejected");
+    }
+
+    auto test_transparent_huge_pages_are_aligned() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size, ie::page_policy::transparent_huge_pages};
+
+        check(buffer.pages() == ie::page_policy::transparent_huge_pages, "the policy was applied");
+        check(is_aligned(buffer.data(), ie::mapped_buffer::huge_page_size), "the buffer starts on a huge page boundary");
+
+        std::fill(buffer.data(), buffer.data() + buffer.size(), std::byte{1});
+    }
+
+    // Without reserved huge pages, MAP_HUGETLB fails and the buffer falls back to THP.
+    auto test_huge_pages_fall_back_to_transparent_huge_pages() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size, ie::page_policy::huge_pages};
+
+        if (buffer.pages() == ie::page_policy::huge_pages) {
+            check(reserved_huge_pages() > 0, "huge pages are only used if they are reserved");
+            check(buffer.page_size() == ie::mapped_buffer::huge_page_size, "the page size is the huge page size");
+        }
+        else {
+            check(buffer.pages() == ie::page_policy::transparent_huge_pages, "the buffer fell back to THP");
+            check(buffer.page_size() == static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)), "the page size is the system's");
+        }
+
+        check(is_aligned(buffer.data(), ie::mapped_buffer::huge_page_size), "the buffer starts on a huge page boundary");
+
+        std::fill(buffer.data(), buffer.data() + buffer.size(), std::byte{1});
+        check(buffer.data()[buffer.size() - 1] == std::byte{1}, "the whole buffer is writable");
+    }
+
+    // MADV_DONTNEED drops the pages. Partial pages at either end of the range are kept.
+    auto test_immediate_release_drops_whole_pages() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size};
+        const auto page_size = buffer.page_size();
+        auto* p = buffer.data();
+
+        std::fill(p, p + 4 * page_size, std::byte{0x5a});
+
+        const auto released = buffer.release(p + 1, 3 * page_size, ie::release_policy::immediate);
+
+        check(released == 2 * page_size, "only the whole pages were released");
+        check(p[0] == std::byte{0x5a} && p[page_size - 1] == std::byte{0x5a}, "the partial first page was kept");
+        check(p[3 * page_size] == std::byte{0x5a}, "the partial last page was kept");
+        check(!is_resident(p + page_size, page_size, page_size), "the released pages are no longer resident");
+        check(p[page_size] == std::byte{} && p[3 * page_size - 1] == std::byte{}, "the released pages read back as zeros");
+
+        check(buffer.release(p + 1, page_size - 2) == 0, "a range without a whole page releases nothing");
+    }
+
+    // The kernel reclaims the pages whenever it likes, so only the reported size is certain.
+    auto test_lazy_release_reports_whole_pages() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size};
+        const auto page_size = buffer.page_size();
+
+        std::fill(buffer.data(), buffer.data() + 4 * page_size, std::byte{1});
+
+        check(buffer.release(buffer.data(), 4 * page_size, ie::release_policy::lazy) == 4 * page_size,
+              "the whole pages were released");
+
+        buffer.data()[0] = std::byte{2};
+        check(buffer.data()[0] == std::byte{2}, "the released memory is usable");
+    }
+
+    // Releasing a shared mapping only drops this process' copy. The data remains in the file.
+    auto test_release_keeps_shared_data() -> void
+    {
+        const auto path = fmt::format("/tmp/mapped_buffer_test.{}.bin", ::getpid());
+        const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        check(fd >= 0, "the file was created");
+        std::remove(path.c_str());
+
+        const auto size = 4 * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        check(::ftruncate(fd, static_cast<off_t>(size)) == 0, "the file was resized");
+
+        ie::mapped_buffer writer{fd, size};
+        ie::mapped_buffer reader{fd, size};
+        ::close(fd);
+
+        check(writer.is_shared(), "a file mapping is shared");
+
+        std::fill(writer.data(), writer.data() + size, std::byte{0x5a});
+        check(reader.data()[size - 1] == std::byte{0x5a}, "writes are visible through every mapping");
+
+        check(writer.release(writer.data(), size, ie::release_policy::lazy) == size, "the pages were released");
+        check(writer.data()[0] == std::byte{0x5a} && writer.data()[size - 1] == std::byte{0x5a}, "the data was kept");
+    }
+
+    auto test_move_transfers_mapping() -> void
+    {
+        ie::mapped_buffer a{buffer_size};
+        auto* data = a.data();
+
+        ie::mapped_buffer b{std::move(a)};
+        check(b.data() == data && b.size() == buffer_size, "the mapping moved");
+        check(a.data() == nullptr && a.size() == 0, "the source is empty");
+
+        ie::mapped_buffer c{4096};
+        c = std::move(b);
+        check(c.data() == data && c.size() == buffer_size, "the mapping was move assigned");
+    }
+
+    auto test_release_unused_memory_keeps_resource_usable() -> void
+    {
+        ie::mapped_buffer buffer{buffer_size};
+        ie::fixed_buffer_resource resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        constexpr std::size_t size = 4 * 1024 * 1024;
+
+        auto* p = static_cast<std::byte*>(resource.allocate(size));
+        std::fill(p, p + size, std::byte{1});
+        resource.deallocate(p, size);
+
+        const auto released = ie::release_unused_memory(resource, buffer, 1024 * 1024);
+
+        check(released >= size - 2 * buffer.page_size(), "the unused block was released");
+        check(resource.is_consistent(), "the free list links survived");
+        check(resource.allocated() == 0, "nothing is allocated");
+
+        p = static_cast<std::byte*>(resource.allocate(size));
+        std::fill(p, p + size, std::byte{2});
+        resource.deallocate(p, size);
+
+        check(resource.is_consistent(), "the resource is still usable");
+        check(ie::release_unused_memory(resource, buffer, 2 * buffer_size) == 0, "blocks below the threshold are kept");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"default_pages_are_writable", test_default_pages_are_writable},
+        {"invalid_size_is_rejected", test_invalid_size_is_rejected},
+        {"transparent_huge_pages_are_aligned", test_transparent_huge_pages_are_aligned},
+        {"huge_pages_fall_back_to_transparent_huge_pages", test_huge_pages_fall_back_to_transparent_huge_pages},
+        {"immediate_release_drops_whole_pages", test_immediate_release_drops_whole_pages},
+        {"lazy_release_reports_whole_pages", test_lazy_release_reports_whole_pages},
+        {"release_keeps_shared_data", test_release_keeps_shared_data},
+        {"move_transfers_mapping", test_move_transfers_mapping},
+        {"release_unused_memory_keeps_resource_usable", test_release_unused_memory_keeps_resource_usable}
+    });
+}
@@ -0,0 +1,301 @@
+#ifndef IRODS_MEMORY_BUDGET_RESOURCE_HPP
+#define IRODS_MEMORY_BUDGET_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+namespace irods::experimental::pmr
+{
+    /// A \p memory_budget_resource is a node in a tree of memory budgets (e.g. process,
+    /// subsystem, request). Every node is a thread-safe memory resource with its own limit, and
+    /// memory allocated through a node counts against that node and all of its ancestors.
+    ///
+    /// Ancestors are charged in batches. A node reserves quota from its parent \p batch_size
+    /// bytes at a time and serves requests from that reservation with a single atomic operation
+    /// on its own counter. Only when the reservation runs out (or grows too large after
+    /// deallocations) does the node lock itself and talk to its parent. The quota a node holds
+    /// in reserve counts against its ancestors, so the limits are enforced exactly but can
+    /// reject a request while a sibling is holding unused quota.
+    ///
+    /// Memory is obtained from the upstream resource of the root node.
+    ///
+    /// \since 4.2.11
+    class memory_budget_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// The default number of bytes a node reserves from its parent at a time.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t default_batch_size = 64 * 1024;
+
+        /// Constructs the root of a budget tree.
+        ///
+        /// \param[in] _limit      The maximum number of bytes charged to the tree.
+        /// \param[in] _upstream   The resource that provides the memory. Must be thread-safe.
+        /// \param[in] _batch_size The number of bytes reserved from the limit at a time.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        explicit memory_budget_resource(std::int64_t _limit,
+                                        boost::container::pmr::memory_resource* _upstream =
+                                            boost::container::pmr::new_delete_resource(),
+                                        std::size_t _batch_size = default_batch_size)
+            : memory_budget_resource{nullptr, _upstream, _limit, _batch_size}
+        {
+        } // memory_budget_resource
+
+        /// Constructs a node whose allocations are also charged to \p _parent.
+        ///
+        /// \param[in] _parent     The enclosing budget. Must outlive this node.
+        /// \param[in] _limit      The maximum number of bytes charged to this node.
+        /// \param[in] _batch_size The number of bytes reserved from \p _parent at a time.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        memory_budget_resource(memory_budget_resource& _parent,
+                               std::int64_t _limit,
+                               std::size_t _batch_size = default_batch_size)
+            : memory_budget_resource{&_parent, _parent.upstream_, _limit, _batch_size}
+        {
+        } // memory_budget_resource
+
+        memory_budget_resource(const memory_budget_resource&) = delete;
+        auto operator=(const memory_budget_resource&) -> memory_budget_resource& = delete;
+
+        /// Returns the unused reservation to the parent.
+        ~memory_budget_resource()
+        {
+            if (parent_) {
+                const auto unused = available_.exchange(0);
+
+                if (unused > 0) {
+                    parent_->release_quota(unused);
+                }
+            }
+        } // ~memory_budget_resource
+
+        /// Returns the maximum number of bytes that may be charged to this node.
+        ///
+        /// \since 4.2.11
+        auto limit() const noexcept -> std::size_t
+        {
+            return limit_;
+        } // limit
+
+        /// Returns the number of bytes charged to this node that are in use, either by
+        /// allocations made through this node or as reservations held by its children.
+        ///
+        /// The value is a snapshot when other threads are allocating.
+        ///
+        /// \since 4.2.11
+        auto allocated() const noexcept -> std::size_t
+        {
+            const auto available = available_.load(std::memory_order_relaxed);
+            const auto charged = charged_.load(std::memory_order_relaxed);
+
+            return charged > available ? charged - available : 0;
+        } // allocated
+
+        /// Returns the number of bytes this node has charged against its limit (and therefore
+        /// against its ancestors), including the unused part of its reservation.
+        ///
+        /// \since 4.2.11
+        auto charged() const noexcept -> std::size_t
+        {
+            return charged_.load(std::memory_order_relaxed);
+        } // charged
+
+        /// Returns the number of requests rejected by this node because its own limit would
+        /// have been exceeded.
+        ///
+        /// \since 4.2.11
+        auto failed_allocations() const noexcept -> std::size_t
+        {
+            return failed_allocations_.load(std::memory_order_relaxed);
+        } // failed_allocations
+
+        /// Returns the enclosing budget, or a null pointer for the root.
+        ///
+        /// \since 4.2.11
+        auto parent() const noexcept -> memory_budget_resource*
+        {
+            return parent_;
+        } // parent
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            if (auto* rejected_by = acquire_quota(_bytes); rejected_by) {
+                rejected_by->failed_allocations_.fetch_add(1, std::memory_order_relaxed);
+                throw std::bad_alloc{};
+            }
+
+            try {
+                return upstream_->allocate(_bytes, _alignment);
+            }
+            catch (...) {
+                release_quota(_bytes);
+                throw;
+            }
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            upstream_->deallocate(_p, _bytes, _alignment);
+            release_quota(_bytes);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        memory_budget_resource(memory_budget_resource* _parent,
+                               boost::container::pmr::memory_resource* _upstream,
+                               std::int64_t _limit,
+                               std::size_t _batch_size)
+            : boost::container::pmr::memory_resource{}
+            , parent_{_parent}
+            , upstream_{_upstream}
+            , limit_(_limit)
+            , batch_size_{_batch_size}
+            , mutex_{}
+            , charged_{}
+            , available_{}
+            , failed_allocations_{}
+        {
+            if (_limit <= 0 || !_upstream || _batch_size == 0) {
+                const auto* msg_fmt = "memory_budget_resource: invalid constructor arguments "
+                                      "[limit={}, upstream={}, batch_size={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, _limit, fmt::ptr(_upstream), _batch_size)};
+            }
+        } // memory_budget_resource
+
+        // Takes "_bytes" out of the reservation, growing the reservation first if necessary.
+        // Returns null on success, otherwise the node (this one or an ancestor) whose limit
+        // rejected the request.
+        auto acquire_quota(std::size_t _bytes) -> memory_budget_resource*
+        {
+            for (;;) {
+                // Fast path: a single atomic operation on this node's counter.
+                auto available = available_.load(std::memory_order_relaxed);
+
+                while (available >= _bytes) {
+                    if (available_.compare_exchange_weak(available, available - _bytes, std::memory_order_relaxed)) {
+                        return nullptr;
+                    }
+                }
+
+                std::lock_guard lock{mutex_};
+
+                // Another thread may have grown the reservation while this one was waiting.
+                available = available_.load(std::memory_order_relaxed);
+
+                if (available >= _bytes) {
+                    continue;
+                }
+
+                const auto charged = charged_.load(std::memory_order_relaxed);
+                const auto room = limit_ - charged;
+
+                if (room + available < _bytes) {
+                    return this;
+                }
+
+                // Near the limit, only reserve what the request needs.
+                const auto shortfall = _bytes - available;
+                auto grow = std::min(std::max(_bytes, batch_size_), room);
+
+                if (parent_) {
+                    // The parent may not be able to spare a whole batch (e.g. because siblings
+                    // hold reservations) but still cover the shortfall.
+                    if (auto* rejected_by = parent_->acquire_quota(grow); rejected_by) {
+                        if (grow == shortfall) {
+                            return rejected_by;
+                        }
+
+                        grow = shortfall;
+
+                        rejected_by = parent_->acquire_quota(grow);
+
+                        if (rejected_by) {
+                            return rejected_by;
+                        }
+                    }
+                }
+
+                charged_.store(charged + grow, std::memory_order_relaxed);
+                available_.fetch_add(grow, std::memory_order_relaxed);
+            }
+        } // acquire_quota
+
+        // Returns "_bytes" to the reservation. Hands the excess back to the parent once the
+        // reservation grows beyond two batches.
+        auto release_quota(std::size_t _bytes) -> void
+        {
+            const auto available = available_.fetch_add(_bytes, std::memory_order_relaxed) + _bytes;
+
+            if (available <= 2 * batch_size_) {
+                return;
+            }
+
+            // Somebody else is already adjusting the reservation.
+            std::unique_lock lock{mutex_, std::try_to_lock};
+
+            if (!lock.owns_lock()) {
+                return;
+            }
+
+            auto current = available_.load(std::memory_order_relaxed);
+
+            while (current > batch_size_) {
+                if (available_.compare_exchange_weak(current, batch_size_, std::memory_order_relaxed)) {
+                    const auto excess = current - batch_size_;
+
+                    charged_.store(charged_.load(std::memory_order_relaxed) - excess, std::memory_order_relaxed);
+
+                    if (parent_) {
+                        parent_->release_quota(excess);
+                    }
+
+                    break;
+                }
+            }
+        } // release_quota
+
+        memory_budget_resource* const parent_;
+        boost::container::pmr::memory_resource* const upstream_;
+        const std::size_t limit_;
+        const std::size_t batch_size_;
+
+        // Serializes changes to the size of the reservation (i.e. "charged_").
+        std::mutex mutex_;
+
+        // "charged_" is the size of the reservation and "available_" is the part of it that is
+        // not in use. Both live on the same cache line because they are only updated together
+        // on the slow path.
+        alignas(64) std::atomic<std::size_t> charged_;
+        std::atomic<std::size_t> available_;
+        std::atomic<std::size_t> failed_allocations_;
+    }; // memory_budget_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_MEMORY_BUDGET_RESOURCE_HPP
@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <new>
+
+#include "memory_budget_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    // A sibling holding a whole batch must not make the other sibling fail while the parent
+    // still has room for the request.
+    auto test_sibling_reservation_does_not_block_small_requests() -> void
+    {
+        ie::memory_budget_resource root{100 * 1024};
+        ie::memory_budget_resource a{root, 100 * 1024};
+        ie::memory_budget_resource b{root, 100 * 1024};
+
+        auto* pa = a.allocate(10);
+        check(root.allocated() == ie::memory_budget_resource::default_batch_size, "a reserved a whole batch");
+
+        void* pb = nullptr;
+
+        try {
+            pb = b.allocate(10);
+        }
+        catch (const std::bad_alloc&) {
+        }
+
+        check(pb != nullptr, "b can allocate from the unreserved part of the root");
+        check(root.failed_allocations() == 0 && b.failed_allocations() == 0, "no failures were recorded");
+
+        b.deallocate(pb, 10);
+        a.deallocate(pa, 10);
+    }
+
+    // Once the unreserved part of the parent is smaller than the request, the request fails
+    // and the failure is charged to the parent.
+    auto test_exhausted_parent_rejects_request() -> void
+    {
+        ie::memory_budget_resource root{100 * 1024};
+        ie::memory_budget_resource a{root, 100 * 1024};
+        ie::memory_budget_resource b{root, 100 * 1024};
+
+        auto* pa = a.allocate(10);
+        bool rejected = false;
+
+        try {
+            b.deallocate(b.allocate(40 * 1024), 40 * 1024);
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "b cannot allocate more than the unreserved part of the root");
+        check(root.failed_allocations() == 1 && b.failed_allocations() == 0, "the root recorded the failure");
+
+        a.deallocate(pa, 10);
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"sibling_reservation_does_not_block_small_requests", test_sibling_reservation_does_not_block_small_requests},
+        {"exhausted_parent_rejects_request", test_exhausted_parent_rejects_request}
+    });
+}
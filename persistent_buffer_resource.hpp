@@ -0,0 +1,198 @@
+#ifndef IRODS_PERSISTENT_BUFFER_RESOURCE_HPP
+#define IRODS_PERSISTENT_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include "mapped_buffer.hpp"
+#include "shared_buffer_resource.hpp"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+namespace irods::experimental::pmr
+{
+    namespace detail
+    {
+        // Owns the file and the mapping of a persistent_buffer_resource. This is a separate
+        // base class so that the mapping exists before the resource is constructed on top of it.
+        class persistent_file
+        {
+        protected:
+            persistent_file(const std::string& _path, std::int64_t _size)
+                : file_{open_and_lock(_path)}
+                , mode_{}
+                , mapping_{file_.fd, prepare(file_.fd, _path, _size, mode_)}
+            {
+            } // persistent_file
+
+            persistent_file(const persistent_file&) = delete;
+            auto operator=(const persistent_file&) -> persistent_file& = delete;
+
+            ~persistent_file() = default;
+
+            // Writes modified pages back to the file and waits for the writes to complete.
+            auto sync() -> void
+            {
+                if (::msync(mapping_.data(), mapping_.size(), MS_SYNC) != 0) {
+                    throw std::system_error{errno, std::generic_category(), "persistent_buffer_resource: msync failed"};
+                }
+            } // sync
+
+            // Closes the descriptor, which also releases the lock. The mapping stays valid
+            // until it is unmapped.
+            struct file_handle
+            {
+                int fd;
+
+                ~file_handle()
+                {
+                    ::close(fd);
+                }
+            }; // struct file_handle
+
+            file_handle file_;
+            open_mode mode_;
+            mapped_buffer mapping_;
+
+        private:
+            static auto open_and_lock(const std::string& _path) -> file_handle
+            {
+                const auto fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+                if (fd < 0) {
+                    throw_system_error("open", _path);
+                }
+
+                // Only one process may use the file at a time. Its mutex is reinitialized on
+                // open, which is only safe if nobody else is using it.
+                if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                    const auto ec = errno;
+                    ::close(fd);
+                    throw std::system_error{ec, std::generic_category(), fmt::format("persistent_buffer_resource: file is in use [path={}]", _path)};
+                }
+
+                return {fd};
+            } // open_and_lock
+
+            // Returns the size of the arena stored in the file, growing the file first if a
+            // new arena has to be created.
+            static auto prepare(int _fd, const std::string& _path, std::int64_t _size, open_mode& _mode) -> std::size_t
+            {
+                struct stat st;
+
+                if (::fstat(_fd, &st) != 0) {
+                    throw_system_error("fstat", _path);
+                }
+
+                // An empty file is treated the same as a missing one.
+                if (st.st_size > 0) {
+                    _mode = open_mode::open_exclusive;
+                    return static_cast<std::size_t>(st.st_size);
+                }
+
+                if (_size <= 0) {
+                    const auto* msg_fmt = "persistent_buffer_resource: invalid size for new file [path={}, size={}].";
+                    throw std::invalid_argument{fmt::format(msg_fmt, _path, _size)};
+                }
+
+                if (::ftruncate(_fd, _size) != 0) {
+                    throw_system_error("ftruncate", _path);
+                }
+
+                _mode = open_mode::create;
+                return static_cast<std::size_t>(_size);
+            } // prepare
+
+            [[noreturn]] static auto throw_system_error(const char* _operation, const std::string& _path) -> void
+            {
+                const auto ec = errno;
+                throw std::system_error{ec, std::generic_category(), fmt::format("persistent_buffer_resource: {} failed [path={}]", _operation, _path)};
+            } // throw_system_error
+        }; // class persistent_file
+    } // namespace detail
+
+    /// A \p persistent_buffer_resource is a \p shared_buffer_resource backed by a file, so that
+    /// the arena and everything allocated from it survive a restart of the process.
+    ///
+    /// The first process to open a missing (or empty) file creates a new arena of the requested
+    /// size. Later runs map the file, reinitialize the lock, verify the allocation table and
+    /// can use the data right away. The entry point is the root object (see \p root() and
+    /// \p set_root()).
+    ///
+    /// The file is mapped at an arbitrary address on every run, so data meant to survive must
+    /// refer to other data in the arena by offset (see \p to_offset() and \p from_offset()),
+    /// not by pointer. This excludes the standard pmr containers, which store the address of
+    /// their memory resource and of their elements.
+    ///
+    /// A file can only be opened by one process at a time. Use \p sync() to make modifications
+    /// durable at a known point. Otherwise, the kernel writes them back at its own pace.
+    ///
+    /// \since 4.2.11
+    class persistent_buffer_resource
+        : private detail::persistent_file
+        , public shared_buffer_resource
+    {
+    public:
+        /// Opens the arena stored in \p _path, creating it if the file does not exist or is
+        /// empty.
+        ///
+        /// \param[in] _path     The path of the file.
+        /// \param[in] _size     The size of the arena in bytes, if it has to be created.
+        ///                      Existing arenas keep their size.
+        /// \param[in] _strategy The algorithm used to locate unused memory, if the arena has
+        ///                      to be created.
+        ///
+        /// \throws std::invalid_argument If a new arena has to be created and \p _size is not
+        ///                               positive.
+        /// \throws std::runtime_error    If the file does not contain a compatible arena, or
+        ///                               the arena failed the consistency check.
+        /// \throws std::system_error     If the file could not be opened, locked or mapped.
+        ///
+        /// \since 4.2.11
+        persistent_buffer_resource(const std::string& _path,
+                                   std::int64_t _size,
+                                   allocation_strategy _strategy = allocation_strategy::two_level_segregated_fit)
+            : detail::persistent_file{_path, _size}
+            , shared_buffer_resource{mapping_.data(), static_cast<std::int64_t>(mapping_.size()), mode_, _strategy}
+        {
+        } // persistent_buffer_resource
+
+        persistent_buffer_resource(const persistent_buffer_resource&) = delete;
+        auto operator=(const persistent_buffer_resource&) -> persistent_buffer_resource& = delete;
+
+        /// Unmaps and unlocks the file. Modifications that were not synced are written back by
+        /// the kernel.
+        ~persistent_buffer_resource() = default;
+
+        /// Returns whether the arena was created by this object (as opposed to reopened).
+        ///
+        /// \since 4.2.11
+        auto created() const noexcept -> bool
+        {
+            return mode_ == open_mode::create;
+        } // created
+
+        /// Writes all modifications to the file and waits for the writes to complete.
+        ///
+        /// \throws std::system_error If the modifications could not be written.
+        ///
+        /// \since 4.2.11
+        auto sync() -> void
+        {
+            detail::persistent_file::sync();
+        } // sync
+    }; // persistent_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_PERSISTENT_BUFFER_RESOURCE_HPP
@@ -0,0 +1,143 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "persistent_buffer_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    // Mirrors the beginning of the segment written by shared_buffer_resource: magic, version
+    // and ready flag, segment size, root, the mutex and then the state of the resource, which
+    // starts with the buffer size, the offset of the first header and the end offset.
+    constexpr std::size_t buffer_size_offset = 4 * sizeof(std::uint64_t) + sizeof(pthread_mutex_t);
+    constexpr std::size_t first_header_offset_offset = buffer_size_offset + sizeof(std::size_t);
+    constexpr std::size_t end_offset_offset = first_header_offset_offset + sizeof(std::size_t);
+
+    constexpr std::int64_t arena_size = 1024 * 1024;
+
+    // Creates a new arena in "_path" holding a single unused block.
+    //
+    // Returns the position of the size of that block in the file. The block is the first one
+    // in the buffer, which makes up the end of the segment.
+    auto create_arena(const std::string& _path) -> std::size_t
+    {
+        std::remove(_path.c_str());
+
+        {
+            ie::persistent_buffer_resource pbr{_path, arena_size};
+            pbr.deallocate(pbr.allocate(100), 100);
+        }
+
+        const auto fd = ::open(_path.c_str(), O_RDONLY);
+        check(fd >= 0, "the arena can be reopened for reading");
+
+        std::size_t buffer_size = 0;
+        const auto read = ::pread(fd, &buffer_size, sizeof(buffer_size), static_cast<off_t>(buffer_size_offset));
+        ::close(fd);
+        check(read == static_cast<ssize_t>(sizeof(buffer_size)), "the buffer size was read");
+
+        // The header of a block holds the size of the previous block, followed by its own.
+        return static_cast<std::size_t>(arena_size) - buffer_size + sizeof(std::size_t);
+    }
+
+    // Overwrites words of the arena in "_path".
+    auto corrupt_arena(const std::string& _path,
+                       std::initializer_list<std::pair<std::size_t, std::size_t>> _words) -> void
+    {
+        const auto fd = ::open(_path.c_str(), O_RDWR);
+        check(fd >= 0, "the arena can be reopened for writing");
+
+        for (const auto& [offset, value] : _words) {
+            const auto written = ::pwrite(fd, &value, sizeof(value), static_cast<off_t>(offset));
+            check(written == static_cast<ssize_t>(sizeof(value)), "the word was overwritten");
+        }
+
+        ::close(fd);
+    }
+
+    auto opening_throws_runtime_error(const std::string& _path) -> bool
+    {
+        try {
+            ie::persistent_buffer_resource pbr{_path, 0};
+        }
+        catch (const std::runtime_error&) {
+            return true;
+        }
+
+        return false;
+    }
+
+    auto test_reopening_intact_arena_succeeds(const std::string& _path) -> void
+    {
+        create_arena(_path);
+
+        ie::persistent_buffer_resource pbr{_path, 0};
+        check(!pbr.created() && pbr.is_consistent(), "the arena was reopened");
+    }
+
+    // A buffer size that does not match the file must be rejected before the allocation
+    // table is walked. Otherwise, the size of the first block leads the walk far outside of
+    // the mapping.
+    auto test_buffer_size_mismatch_is_rejected(const std::string& _path) -> void
+    {
+        const auto block_size_offset = create_arena(_path);
+        corrupt_arena(_path, {{buffer_size_offset, std::size_t{1} << 40},
+                              {end_offset_offset, std::size_t{1} << 39},
+                              {block_size_offset, std::size_t{1} << 38}});
+
+        check(opening_throws_runtime_error(_path), "a mismatched buffer size was rejected");
+    }
+
+    auto test_end_offset_outside_buffer_is_rejected(const std::string& _path) -> void
+    {
+        const auto block_size_offset = create_arena(_path);
+        corrupt_arena(_path, {{end_offset_offset, std::size_t{1} << 39},
+                              {block_size_offset, std::size_t{1} << 38}});
+
+        check(opening_throws_runtime_error(_path), "an end offset outside the buffer was rejected");
+    }
+
+    // The sum of the offsets wraps around to a value within the buffer, while the first header
+    // lies half a megabyte in front of the segment.
+    auto test_overflowing_offsets_are_rejected(const std::string& _path) -> void
+    {
+        constexpr std::size_t distance = 512 * 1024;
+
+        create_arena(_path);
+        corrupt_arena(_path, {{first_header_offset_offset, ~distance + 1},
+                              {end_offset_offset, distance + 64}});
+
+        check(opening_throws_runtime_error(_path), "overflowing offsets were rejected");
+    }
+} // anonymous namespace
+
+int main()
+{
+    const auto path = fmt::format("/tmp/persistent_buffer_resource_test.{}.bin", ::getpid());
+
+    const auto ec = ie::test::run({
+        {"reopening_intact_arena_succeeds", [&path] { test_reopening_intact_arena_succeeds(path); }},
+        {"buffer_size_mismatch_is_rejected", [&path] { test_buffer_size_mismatch_is_rejected(path); }},
+        {"end_offset_outside_buffer_is_rejected", [&path] { test_end_offset_outside_buffer_is_rejected(path); }},
+        {"overflowing_offsets_are_rejected", [&path] { test_overflowing_offsets_are_rejected(path); }}
+    });
+
+    std::remove(path.c_str());
+
+    return ec;
+}
@@ -0,0 +1,398 @@
+#ifndef IRODS_SHARDED_BUFFER_RESOURCE_HPP
+#define IRODS_SHARDED_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+#include "mapped_buffer.hpp"
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace irods::experimental::pmr
+{
+    /// Describes which CPUs belong to which NUMA node.
+    ///
+    /// \since 4.2.11
+    struct numa_topology
+    {
+        /// The online NUMA nodes, in ascending order.
+        std::vector<int> nodes;
+
+        /// The node of each configured CPU, indexed by CPU number.
+        std::vector<int> node_of_cpu;
+
+        /// Reads the topology of the host from sysfs. Hosts without NUMA support are reported
+        /// as a single node 0 holding every CPU.
+        ///
+        /// \since 4.2.11
+        static auto detect() -> numa_topology
+        {
+            const auto cpu_count = std::max<long>(1, ::sysconf(_SC_NPROCESSORS_CONF));
+
+            numa_topology t;
+            t.nodes = parse_list(read_line("/sys/devices/system/node/online"));
+            t.node_of_cpu.assign(static_cast<std::size_t>(cpu_count), -1);
+
+            for (const auto node : t.nodes) {
+                for (const auto cpu : parse_list(read_line(fmt::format("/sys/devices/system/node/node{}/cpulist", node)))) {
+                    if (cpu >= 0 && cpu < cpu_count) {
+                        t.node_of_cpu[cpu] = node;
+                    }
+                }
+            }
+
+            if (t.nodes.empty()) {
+                t.nodes.push_back(0);
+            }
+
+            // CPUs not listed under any node (e.g. sysfs is unavailable) count as the first.
+            std::replace(std::begin(t.node_of_cpu), std::end(t.node_of_cpu), -1, t.nodes.front());
+
+            return t;
+        } // detect
+
+    private:
+        static auto read_line(const std::string& _path) -> std::string
+        {
+            std::ifstream in{_path};
+            std::string line;
+            std::getline(in, line);
+            return line;
+        } // read_line
+
+        // Parses the list format used by sysfs (e.g. "0-3,8,10-11").
+        static auto parse_list(std::string_view _list) -> std::vector<int>
+        {
+            std::vector<int> values;
+
+            while (!_list.empty()) {
+                const auto comma = _list.find(',');
+                const auto item = _list.substr(0, comma);
+                const auto dash = item.find('-');
+
+                try {
+                    const auto first = std::stoi(std::string{item.substr(0, dash)});
+                    const auto last = dash == std::string_view::npos ? first : std::stoi(std::string{item.substr(dash + 1)});
+
+                    for (auto i = first; i <= last; ++i) {
+                        values.push_back(i);
+                    }
+                }
+                catch (const std::exception&) {
+                    return {};
+                }
+
+                _list = comma == std::string_view::npos ? std::string_view{} : _list.substr(comma + 1);
+            }
+
+            return values;
+        } // parse_list
+    }; // struct numa_topology
+
+    /// Defines how a \p sharded_buffer_resource splits its cap.
+    ///
+    /// \since 4.2.11
+    enum class shard_policy
+    {
+        /// One shard per NUMA node, shared by the CPUs of that node.
+        per_node,
+
+        /// One shard per CPU. Threads on different CPUs never contend, but a thread that
+        /// migrates to another CPU allocates from (and may deallocate into) another shard.
+        per_cpu
+    }; // enum class shard_policy
+
+    /// A \p sharded_buffer_resource is a thread-safe memory resource that splits a total cap
+    /// into shards, each a \p fixed_buffer_resource over its own \p mapped_buffer. The buffer
+    /// of a shard is placed on the NUMA node of the CPUs it serves, so that threads allocate
+    /// node-local memory and threads on different nodes (or CPUs) do not contend for a lock.
+    ///
+    /// A request is served by the shard of the CPU the calling thread runs on. If that shard
+    /// is full, the other shards are tried, those on the same node first. Memory is always
+    /// returned to the shard it came from. Because the shards split the cap between them, the
+    /// total amount of memory in use never exceeds the cap, but a request fails if no single
+    /// shard has room for it, even if the shards combined do.
+    ///
+    /// This class requires Linux (sysfs, \p sched_getcpu and \p mbind). Placement is a
+    /// preference. Without NUMA support, every shard lives on node 0.
+    ///
+    /// \since 4.2.11
+    class sharded_buffer_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Constructs a \p sharded_buffer_resource.
+        ///
+        /// \param[in] _total_size The cap, in bytes, split evenly between the shards.
+        /// \param[in] _policy     How the cap is split.
+        /// \param[in] _strategy   The algorithm used by each shard.
+        /// \param[in] _commit     When the memory of the shards is committed. Committing
+        ///                        up front touches every page on construction, after the
+        ///                        placement has been applied.
+        /// \param[in] _topology   The CPUs and NUMA nodes to create shards for.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        /// \throws std::system_error     If a buffer could not be mapped.
+        ///
+        /// \since 4.2.11
+        explicit sharded_buffer_resource(std::size_t _total_size,
+                                         shard_policy _policy = shard_policy::per_node,
+                                         allocation_strategy _strategy = allocation_strategy::two_level_segregated_fit,
+                                         commit_policy _commit = commit_policy::on_demand,
+                                         const numa_topology& _topology = numa_topology::detect())
+            : boost::container::pmr::memory_resource{}
+            , shards_{}
+            , shard_of_cpu_(_topology.node_of_cpu.size())
+            , steal_order_{}
+            , address_index_{}
+            , stolen_allocations_{}
+        {
+            const auto shard_count = _policy == shard_policy::per_node ? _topology.nodes.size() : _topology.node_of_cpu.size();
+
+            if (shard_count == 0 || _topology.node_of_cpu.empty() || _total_size / shard_count < minimum_shard_size) {
+                const auto* msg_fmt = "sharded_buffer_resource: invalid constructor arguments [total_size={}, shards={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, _total_size, shard_count)};
+            }
+
+            std::vector<int> node_of_shard;
+
+            if (_policy == shard_policy::per_node) {
+                node_of_shard = _topology.nodes;
+
+                for (std::size_t cpu = 0; cpu < shard_of_cpu_.size(); ++cpu) {
+                    const auto node = std::find(std::begin(node_of_shard), std::end(node_of_shard), _topology.node_of_cpu[cpu]);
+                    shard_of_cpu_[cpu] = static_cast<std::size_t>(node - std::begin(node_of_shard)) % shard_count;
+                }
+            }
+            else {
+                node_of_shard = _topology.node_of_cpu;
+
+                for (std::size_t cpu = 0; cpu < shard_of_cpu_.size(); ++cpu) {
+                    shard_of_cpu_[cpu] = cpu;
+                }
+            }
+
+            // The last shard absorbs the remainder, so the sizes add up to the cap exactly.
+            const auto shard_size = _total_size / shard_count;
+
+            for (std::size_t i = 0; i < shard_count; ++i) {
+                const auto size = i + 1 < shard_count ? shard_size : _total_size - shard_size * (shard_count - 1);
+                shards_.push_back(std::make_unique<shard>(size, node_of_shard[i], _strategy, _commit));
+                address_index_.push_back(i);
+            }
+
+            for (std::size_t i = 0; i < shard_count; ++i) {
+                auto& order = steal_order_.emplace_back();
+
+                for (std::size_t j = 1; j < shard_count; ++j) {
+                    order.push_back((i + j) % shard_count);
+                }
+
+                std::stable_partition(std::begin(order), std::end(order), [&](auto _j) {
+                    return node_of_shard[_j] == node_of_shard[i];
+                });
+            }
+
+            std::sort(std::begin(address_index_), std::end(address_index_), [this](auto _a, auto _b) {
+                return shards_[_a]->buffer.data() < shards_[_b]->buffer.data();
+            });
+        } // sharded_buffer_resource
+
+        sharded_buffer_resource(const sharded_buffer_resource&) = delete;
+        auto operator=(const sharded_buffer_resource&) -> sharded_buffer_resource& = delete;
+
+        ~sharded_buffer_resource() = default;
+
+        /// Returns the number of shards.
+        ///
+        /// \since 4.2.11
+        auto shard_count() const noexcept -> std::size_t
+        {
+            return shards_.size();
+        } // shard_count
+
+        /// Returns the NUMA node the buffer of shard \p _shard is placed on.
+        ///
+        /// \since 4.2.11
+        auto shard_node(std::size_t _shard) const -> int
+        {
+            return shards_.at(_shard)->node;
+        } // shard_node
+
+        /// Returns the size of the buffer of shard \p _shard in bytes, i.e. its part of the cap.
+        ///
+        /// \since 4.2.11
+        auto shard_size(std::size_t _shard) const -> std::size_t
+        {
+            return shards_.at(_shard)->buffer.size();
+        } // shard_size
+
+        /// Returns the number of bytes used by the client in shard \p _shard.
+        ///
+        /// \since 4.2.11
+        auto shard_allocated(std::size_t _shard) const -> std::size_t
+        {
+            auto& s = *shards_.at(_shard);
+            std::lock_guard lk{s.mtx};
+            return s.resource.allocated();
+        } // shard_allocated
+
+        /// Returns the number of bytes used by the client in all shards. The value is a
+        /// snapshot when other threads are allocating.
+        ///
+        /// \since 4.2.11
+        auto allocated() const -> std::size_t
+        {
+            std::size_t total = 0;
+
+            for (std::size_t i = 0; i < shards_.size(); ++i) {
+                total += shard_allocated(i);
+            }
+
+            return total;
+        } // allocated
+
+        /// Returns the number of requests served by a shard other than the caller's.
+        ///
+        /// \since 4.2.11
+        auto stolen_allocations() const noexcept -> std::size_t
+        {
+            return stolen_allocations_.load(std::memory_order_relaxed);
+        } // stolen_allocations
+
+        /// Returns the shard serving the calling thread at this moment.
+        ///
+        /// \since 4.2.11
+        auto current_shard() const noexcept -> std::size_t
+        {
+            const auto cpu = ::sched_getcpu();
+
+            if (cpu < 0) {
+                // The CPU is unknown. Spread threads over the shards by their id instead.
+                return std::hash<std::thread::id>{}(std::this_thread::get_id()) % shards_.size();
+            }
+
+            return shard_of_cpu_[static_cast<std::size_t>(cpu) % shard_of_cpu_.size()];
+        } // current_shard
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            const auto home = current_shard();
+
+            if (auto* p = try_allocate(*shards_[home], _bytes, _alignment); p) {
+                return p;
+            }
+
+            for (const auto i : steal_order_[home]) {
+                if (auto* p = try_allocate(*shards_[i], _bytes, _alignment); p) {
+                    stolen_allocations_.fetch_add(1, std::memory_order_relaxed);
+                    return p;
+                }
+            }
+
+            throw std::bad_alloc{};
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            auto& s = shard_of(_p);
+            std::lock_guard lk{s.mtx};
+            s.resource.deallocate(_p, _bytes, _alignment);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        // Shards smaller than this cannot hold the bookkeeping of a fixed_buffer_resource and
+        // a useful amount of memory.
+        static constexpr std::size_t minimum_shard_size = 64 * 1024;
+
+        struct alignas(64) shard
+        {
+            shard(std::size_t _size, int _node, allocation_strategy _strategy, commit_policy _commit)
+                : buffer{map_on_node(_size, _node, _commit)}
+                , node{_node}
+                , resource{buffer.data(), static_cast<std::int64_t>(_size), _strategy}
+                , mtx{}
+            {
+            }
+
+            // The placement must happen before the resource touches the buffer.
+            static auto map_on_node(std::size_t _size, int _node, commit_policy _commit) -> mapped_buffer
+            {
+                mapped_buffer b{_size};
+                b.prefer_node(_node);
+
+                // MAP_POPULATE would commit the pages before the placement is known.
+                if (_commit == commit_policy::immediate) {
+                    std::memset(b.data(), 0, _size);
+                }
+
+                return b;
+            }
+
+            mapped_buffer buffer;
+            int node;
+            fixed_buffer_resource<std::byte> resource;
+            mutable std::mutex mtx;
+        }; // struct shard
+
+        static auto try_allocate(shard& _shard, std::size_t _bytes, std::size_t _alignment) -> void*
+        {
+            std::lock_guard lk{_shard.mtx};
+
+            try {
+                return _shard.resource.allocate(_bytes, _alignment);
+            }
+            catch (const std::bad_alloc&) {
+                return nullptr;
+            }
+        } // try_allocate
+
+        auto shard_of(void* _p) const noexcept -> shard&
+        {
+            // The last shard whose buffer starts at or before the pointer.
+            const auto it = std::upper_bound(std::begin(address_index_), std::end(address_index_), _p, [this](void* _q, auto _i) {
+                return static_cast<std::byte*>(_q) < shards_[_i]->buffer.data();
+            });
+
+            return *shards_[*std::prev(it)];
+        } // shard_of
+
+        std::vector<std::unique_ptr<shard>> shards_;
+        std::vector<std::size_t> shard_of_cpu_;
+        std::vector<std::vector<std::size_t>> steal_order_;
+        std::vector<std::size_t> address_index_;
+        std::atomic<std::size_t> stolen_allocations_;
+    }; // sharded_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_SHARDED_BUFFER_RESOURCE_HPP
@@ -0,0 +1,207 @@
+#include <cstddef>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "sharded_buffer_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    constexpr std::size_t block_size = 16 * 1024;
+
+    // A host with "_nodes" NUMA nodes of "_cpus_per_node" CPUs each, numbered node by node.
+    auto make_topology(int _nodes, int _cpus_per_node) -> ie::numa_topology
+    {
+        ie::numa_topology t;
+
+        for (int node = 0; node < _nodes; ++node) {
+            t.nodes.push_back(node);
+
+            for (int cpu = 0; cpu < _cpus_per_node; ++cpu) {
+                t.node_of_cpu.push_back(node);
+            }
+        }
+
+        return t;
+    }
+
+    // Returns the shard whose usage differs between the two snapshots, or shard_count() if none
+    // or several do.
+    auto changed_shard(const std::vector<std::size_t>& _before, const std::vector<std::size_t>& _after) -> std::size_t
+    {
+        std::size_t changed = _before.size();
+
+        for (std::size_t i = 0; i < _before.size(); ++i) {
+            if (_before[i] != _after[i]) {
+                if (changed != _before.size()) {
+                    return _before.size();
+                }
+
+                changed = i;
+            }
+        }
+
+        return changed;
+    }
+
+    auto usage(const ie::sharded_buffer_resource& _resource) -> std::vector<std::size_t>
+    {
+        std::vector<std::size_t> u;
+
+        for (std::size_t i = 0; i < _resource.shard_count(); ++i) {
+            u.push_back(_resource.shard_allocated(i));
+        }
+
+        return u;
+    }
+
+    auto shard_sizes(const ie::sharded_buffer_resource& _resource) -> std::vector<std::size_t>
+    {
+        std::vector<std::size_t> sizes;
+
+        for (std::size_t i = 0; i < _resource.shard_count(); ++i) {
+            sizes.push_back(_resource.shard_size(i));
+        }
+
+        return sizes;
+    }
+
+    auto test_shard_sizes_add_up_to_cap() -> void
+    {
+        // A cap that does not divide evenly between the shards.
+        constexpr std::size_t cap = 3 * 1024 * 1024 + 5;
+
+        {
+            ie::sharded_buffer_resource resource{cap, ie::shard_policy::per_node, ie::allocation_strategy::first_fit,
+                                                 ie::commit_policy::on_demand, make_topology(3, 2)};
+
+            const auto sizes = shard_sizes(resource);
+
+            check(resource.shard_count() == 3, "there is one shard per node");
+            check(std::accumulate(std::begin(sizes), std::end(sizes), std::size_t{0}) == cap, "the shard sizes add up to the cap");
+            check(sizes[0] == cap / 3 && sizes[1] == cap / 3, "the cap is split evenly");
+            check(sizes[2] == cap / 3 + cap % 3, "the last shard holds the remainder");
+
+            for (std::size_t i = 0; i < resource.shard_count(); ++i) {
+                check(resource.shard_node(i) == static_cast<int>(i), "each shard serves its node");
+            }
+        }
+
+        {
+            ie::sharded_buffer_resource resource{cap, ie::shard_policy::per_cpu, ie::allocation_strategy::first_fit,
+                                                 ie::commit_policy::on_demand, make_topology(2, 4)};
+
+            const auto sizes = shard_sizes(resource);
+
+            check(resource.shard_count() == 8, "there is one shard per CPU");
+            check(std::accumulate(std::begin(sizes), std::end(sizes), std::size_t{0}) == cap, "the shard sizes add up to the cap");
+            check(resource.shard_node(3) == 0 && resource.shard_node(4) == 1, "each shard lives on the node of its CPU");
+        }
+
+        bool rejected = false;
+
+        try {
+            ie::sharded_buffer_resource{64 * 1024, ie::shard_policy::per_cpu, ie::allocation_strategy::first_fit,
+                                        ie::commit_policy::on_demand, make_topology(1, 4)};
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+
+        check(rejected, "a cap too small for the shards is rejected");
+    }
+
+    // Fills every shard, so that most requests are served by a shard other than the caller's,
+    // then frees the memory from another thread. Each block must go back to the shard it came
+    // from, otherwise that shard's resource would take in memory outside its buffer.
+    auto test_deallocation_reaches_owning_shard() -> void
+    {
+        constexpr std::size_t cap = 4 * 256 * 1024;
+
+        ie::sharded_buffer_resource resource{cap, ie::shard_policy::per_cpu, ie::allocation_strategy::first_fit,
+                                             ie::commit_policy::on_demand, make_topology(2, 2)};
+
+        struct allocation
+        {
+            void* p;
+            std::size_t shard;
+        };
+
+        std::vector<allocation> blocks;
+
+        const auto fill = [&] {
+            for (;;) {
+                const auto before = usage(resource);
+
+                try {
+                    auto* p = resource.allocate(block_size);
+                    blocks.push_back({p, changed_shard(before, usage(resource))});
+                }
+                catch (const std::bad_alloc&) {
+                    return;
+                }
+            }
+        };
+
+        fill();
+
+        const auto count = blocks.size();
+
+        check(resource.stolen_allocations() > 0, "requests were served by other shards");
+        check(resource.allocated() == count * block_size, "allocated() counts every block");
+
+        for (std::size_t i = 0; i < resource.shard_count(); ++i) {
+            check(resource.shard_allocated(i) > 0, "every shard serves requests");
+        }
+
+        for (const auto& b : blocks) {
+            check(b.shard < resource.shard_count(), "each request was served by exactly one shard");
+        }
+
+        // Free in reverse order from another thread, recording which shard each block went to.
+        std::vector<std::size_t> returned_to;
+
+        std::thread{[&] {
+            for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+                const auto before = usage(resource);
+                resource.deallocate(it->p, block_size);
+                returned_to.push_back(changed_shard(before, usage(resource)));
+            }
+        }}.join();
+
+        for (std::size_t i = 0; i < count; ++i) {
+            check(returned_to[i] == blocks[count - 1 - i].shard, "the block was returned to the shard it came from");
+        }
+
+        for (std::size_t i = 0; i < resource.shard_count(); ++i) {
+            check(resource.shard_allocated(i) == 0, "the shard is empty");
+        }
+
+        // The shards take the memory back in full.
+        blocks.clear();
+        fill();
+
+        check(blocks.size() == count, "the shards hold as many blocks as before");
+
+        for (const auto& b : blocks) {
+            resource.deallocate(b.p, block_size);
+        }
+
+        check(resource.allocated() == 0, "nothing is allocated");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"shard_sizes_add_up_to_cap", test_shard_sizes_add_up_to_cap},
+        {"deallocation_reaches_owning_shard", test_deallocation_reaches_owning_shard}
+    });
+}
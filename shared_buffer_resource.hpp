@@ -0,0 +1,408 @@
+#ifndef IRODS_SHARED_BUFFER_RESOURCE_HPP
+#define IRODS_SHARED_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace irods::experimental::pmr
+{
+    /// Defines how a \p shared_buffer_resource treats the segment given on construction.
+    ///
+    /// \since 4.2.11
+    enum class open_mode
+    {
+        /// Initialize a new arena in the segment, discarding its previous contents.
+        create,
+
+        /// Attach to the arena another process created in the segment.
+        open_existing,
+
+        /// Attach to an arena that no other process is using, such as one persisted in a file
+        /// by a previous run. The mutex is reinitialized (its previous state is meaningless
+        /// after a restart) and the arena is verified before it is used.
+        open_exclusive
+    }; // enum class open_mode
+
+    /// A \p shared_buffer_resource is a \p fixed_buffer_resource whose state lives inside the
+    /// buffer, so that several processes can allocate from the same capped arena (e.g. a POSIX
+    /// shared memory object, memfd or file mapped with \p mapped_buffer).
+    ///
+    /// The segment begins with a small header holding a process-shared mutex and the state of
+    /// the resource. All bookkeeping refers to blocks by offset, so every process may map the
+    /// segment at a different address. Pointers returned by \p allocate() are only meaningful
+    /// in the calling process. Use \p to_offset() and \p from_offset() to store references to
+    /// shared memory in shared memory. A single root object can be published through
+    /// \p set_root() so that other processes (or later runs) can find the data.
+    ///
+    /// Allocation and deallocation are serialized by a robust process-shared mutex. If a process
+    /// dies while holding it, the next process to lock it verifies the arena and either carries
+    /// on or reports the arena as corrupted.
+    ///
+    /// Alignments up to the page size hold in every process. Larger alignments only hold in
+    /// processes that map the segment at equally aligned addresses.
+    ///
+    /// Checkpoints are not supported. The reserved block and the scope would live in the
+    /// segment, so a rewind in one process would release memory another process still uses.
+    ///
+    /// \since 4.2.11
+    class shared_buffer_resource
+        : public fixed_buffer_resource<std::byte>
+    {
+    public:
+        /// Identifies segments initialized by this class.
+        ///
+        /// \since 4.2.11
+        static constexpr std::uint64_t magic = 0x6972'6f64'7362'7266; // "irodsbrf"
+
+        /// The version of the segment layout.
+        ///
+        /// \since 4.2.11
+        static constexpr std::uint32_t version = 5;
+
+        /// Constructs a \p shared_buffer_resource over the given segment.
+        ///
+        /// When creating, no other process may use the segment until the constructor returns.
+        ///
+        /// \param[in] _segment      The beginning of the shared segment. Must be aligned to the
+        ///                          page size.
+        /// \param[in] _segment_size The size of the segment in bytes.
+        /// \param[in] _mode         Whether to create a new arena or attach to an existing one.
+        /// \param[in] _strategy     The algorithm used to locate unused memory. Ignored when
+        ///                          attaching. Defaults to TLSF so that the time the lock is
+        ///                          held stays bounded.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        /// \throws std::runtime_error    If the segment does not contain a compatible arena, or
+        ///                               (when opening exclusively) if the arena is corrupted.
+        /// \throws std::system_error     If the mutex could not be initialized.
+        ///
+        /// \since 4.2.11
+        shared_buffer_resource(void* _segment,
+                               std::int64_t _segment_size,
+                               open_mode _mode,
+                               allocation_strategy _strategy = allocation_strategy::two_level_segregated_fit)
+            : shared_buffer_resource{prepare_segment(_segment, _segment_size, _mode), _segment_size, _mode, _strategy}
+        {
+        } // shared_buffer_resource
+
+        shared_buffer_resource(const shared_buffer_resource&) = delete;
+        auto operator=(const shared_buffer_resource&) -> shared_buffer_resource& = delete;
+
+        /// Detaches from the segment. The arena and all allocations in it remain intact.
+        ~shared_buffer_resource() = default;
+
+        /// Returns the root object, or null if none was published.
+        ///
+        /// \since 4.2.11
+        auto root() const noexcept -> void*
+        {
+            return from_offset(segment_->root.load(std::memory_order_acquire));
+        } // root
+
+        /// Publishes \p _p as the root object. Whatever \p _p points to must be fully
+        /// constructed before the call.
+        ///
+        /// \param[in] _p A pointer to memory allocated from this arena, or null.
+        ///
+        /// \since 4.2.11
+        auto set_root(void* _p) noexcept -> void
+        {
+            segment_->root.store(to_offset(_p), std::memory_order_release);
+        } // set_root
+
+        /// Returns the offset of \p _p from the beginning of the segment.
+        ///
+        /// \param[in] _p A pointer into the segment, or null.
+        ///
+        /// \return The offset, or zero if \p _p is null (the segment header occupies offset
+        ///         zero, so it never refers to an allocation).
+        ///
+        /// \since 4.2.11
+        auto to_offset(const void* _p) const noexcept -> std::uint64_t
+        {
+            if (!_p) {
+                return 0;
+            }
+
+            return static_cast<std::uint64_t>(static_cast<const std::byte*>(_p) - reinterpret_cast<const std::byte*>(segment_));
+        } // to_offset
+
+        /// Returns the address of the byte at \p _offset within this process' mapping of the
+        /// segment, or null if \p _offset is zero.
+        ///
+        /// \since 4.2.11
+        auto from_offset(std::uint64_t _offset) const noexcept -> void*
+        {
+            if (_offset == 0) {
+                return nullptr;
+            }
+
+            return reinterpret_cast<std::byte*>(segment_) + _offset;
+        } // from_offset
+
+        auto checkpoint() noexcept -> checkpoint_type = delete;
+        auto rewind(const checkpoint_type& _checkpoint) noexcept -> void = delete;
+
+        /// Writes the state of the allocation table to the output stream (see
+        /// \p fixed_buffer_resource::print()). The mutex is held while writing.
+        ///
+        /// \since 4.2.11
+        auto print(std::ostream& _os) const -> void
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::print(_os);
+        } // print
+
+        /// Invokes \p _func for every unused block (see
+        /// \p fixed_buffer_resource::for_each_unused_block()). The mutex is held while
+        /// \p _func runs, so it must not allocate from the arena.
+        ///
+        /// \since 4.2.11
+        template <typename Function>
+        auto for_each_unused_block(Function _func) const -> void
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::for_each_unused_block(std::move(_func));
+        } // for_each_unused_block
+
+        /// Verifies the arena while holding the mutex (see
+        /// \p fixed_buffer_resource::is_consistent()).
+        ///
+        /// \return False if the arena is corrupted or the mutex could not be locked.
+        ///
+        /// \since 4.2.11
+        auto is_consistent() const noexcept -> bool
+        {
+            try {
+                lock_guard lock{*this};
+                return fixed_buffer_resource::is_consistent();
+            }
+            catch (...) {
+                return false;
+            }
+        } // is_consistent
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            lock_guard lock{*this};
+            return fixed_buffer_resource::do_allocate(_bytes, _alignment);
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::do_deallocate(_p, _bytes, _alignment);
+        } // do_deallocate
+
+        auto do_allocate_bulk(std::size_t _count, std::size_t _bytes, std::size_t _alignment, void** _out) -> void override
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::do_allocate_bulk(_count, _bytes, _alignment, _out);
+        } // do_allocate_bulk
+
+        auto do_deallocate_bulk(void* const* _p, std::size_t _count, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::do_deallocate_bulk(_p, _count, _bytes, _alignment);
+        } // do_deallocate_bulk
+
+        auto do_try_expand(void* _p, std::size_t _old_size, std::size_t _new_size) -> bool override
+        {
+            lock_guard lock{*this};
+            return fixed_buffer_resource::do_try_expand(_p, _old_size, _new_size);
+        } // do_try_expand
+
+        auto do_shrink_in_place(void* _p, std::size_t _old_size, std::size_t _new_size) -> void override
+        {
+            lock_guard lock{*this};
+            fixed_buffer_resource::do_shrink_in_place(_p, _old_size, _new_size);
+        } // do_shrink_in_place
+
+        auto do_usable_size(const void* _p) const -> std::size_t override
+        {
+            // No lock is needed. The size of a block in use is only modified by its owner.
+            return fixed_buffer_resource::do_usable_size(_p);
+        } // do_usable_size
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            // Memory can be returned through any object attached to the same segment.
+            const auto* other = dynamic_cast<const shared_buffer_resource*>(&_other);
+            return other && other->segment_ == segment_;
+        } // do_is_equal
+
+    private:
+        // Lives at the beginning of the segment.
+        struct segment_header
+        {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::atomic<std::uint32_t> ready;  // Set once the arena is fully initialized.
+            std::uint64_t segment_size;
+            std::atomic<std::uint64_t> root;   // Offset of the root object, or zero.
+            pthread_mutex_t mutex;
+            control_block control;
+        }; // struct segment_header
+
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+        // Locks the segment's mutex, recovering it if its previous owner died.
+        class lock_guard
+        {
+        public:
+            explicit lock_guard(const shared_buffer_resource& _resource)
+                : mutex_{&_resource.segment_->mutex}
+            {
+                const auto ec = pthread_mutex_lock(mutex_);
+
+                if (ec == EOWNERDEAD) {
+                    // The previous owner may have died in the middle of an update. Only carry
+                    // on if the arena survived. Unlocking without marking the mutex consistent
+                    // makes it permanently unusable for every process.
+                    if (!_resource.fixed_buffer_resource::is_consistent()) {
+                        pthread_mutex_unlock(mutex_);
+                        throw std::runtime_error{"shared_buffer_resource: arena corrupted by a process that died while allocating."};
+                    }
+
+                    pthread_mutex_consistent(mutex_);
+                }
+                else if (ec == ENOTRECOVERABLE) {
+                    throw std::runtime_error{"shared_buffer_resource: arena corrupted by a process that died while allocating."};
+                }
+                else if (ec != 0) {
+                    throw std::system_error{ec, std::generic_category(), "shared_buffer_resource: could not lock mutex"};
+                }
+            }
+
+            lock_guard(const lock_guard&) = delete;
+            auto operator=(const lock_guard&) -> lock_guard& = delete;
+
+            ~lock_guard()
+            {
+                pthread_mutex_unlock(mutex_);
+            }
+
+        private:
+            pthread_mutex_t* mutex_;
+        }; // class lock_guard
+
+        shared_buffer_resource(segment_header* _segment,
+                               std::int64_t _segment_size,
+                               open_mode _mode,
+                               allocation_strategy _strategy)
+            : fixed_buffer_resource{reinterpret_cast<std::byte*>(_segment) + sizeof(segment_header),
+                                    _segment_size - static_cast<std::int64_t>(sizeof(segment_header)),
+                                    _strategy,
+                                    &_segment->control,
+                                    _mode != open_mode::create}
+            , segment_{_segment}
+        {
+            if (_mode == open_mode::create) {
+                segment_->ready.store(1, std::memory_order_release);
+            }
+            else if (_mode == open_mode::open_exclusive && !is_consistent()) {
+                throw std::runtime_error{"shared_buffer_resource: arena failed consistency check."};
+            }
+        } // shared_buffer_resource
+
+        // Validates the segment and, when creating, initializes everything but the state of
+        // the resource (which the base class initializes).
+        static auto prepare_segment(void* _segment, std::int64_t _segment_size, open_mode _mode) -> segment_header*
+        {
+            const auto min_size = static_cast<std::int64_t>(sizeof(segment_header));
+
+            if (!_segment ||
+                _segment_size <= min_size ||
+                reinterpret_cast<std::uintptr_t>(_segment) % alignof(segment_header) != 0)
+            {
+                const auto* msg_fmt = "shared_buffer_resource: invalid constructor arguments "
+                                      "[segment={}, size={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, fmt::ptr(_segment), _segment_size)};
+            }
+
+            if (_mode != open_mode::create) {
+                auto* h = static_cast<segment_header*>(_segment);
+
+                if (h->magic != magic || h->ready.load(std::memory_order_acquire) != 1) {
+                    throw std::runtime_error{"shared_buffer_resource: segment does not contain an arena."};
+                }
+
+                if (h->version != version) {
+                    const auto* msg_fmt = "shared_buffer_resource: unsupported segment version [expected={}, actual={}].";
+                    throw std::runtime_error{fmt::format(msg_fmt, version, h->version)};
+                }
+
+                if (h->segment_size > static_cast<std::uint64_t>(_segment_size)) {
+                    const auto* msg_fmt = "shared_buffer_resource: segment is smaller than the arena [arena={}, segment={}].";
+                    throw std::runtime_error{fmt::format(msg_fmt, h->segment_size, _segment_size)};
+                }
+
+                // The consistency check trusts the size of the buffer, so it must describe the
+                // segment before anything else in the arena is read.
+                if (h->segment_size <= sizeof(segment_header) ||
+                    h->control.buffer_size != h->segment_size - sizeof(segment_header))
+                {
+                    const auto* msg_fmt = "shared_buffer_resource: arena does not match the segment [buffer={}, segment={}].";
+                    throw std::runtime_error{fmt::format(msg_fmt, h->control.buffer_size, h->segment_size)};
+                }
+
+                if (_mode == open_mode::open_exclusive) {
+                    init_mutex(h->mutex);
+                }
+
+                return h;
+            }
+
+            auto* h = new (_segment) segment_header;
+            h->magic = magic;
+            h->version = version;
+            h->ready.store(0, std::memory_order_relaxed);
+            h->segment_size = static_cast<std::uint64_t>(_segment_size);
+            h->root.store(0, std::memory_order_relaxed);
+
+            init_mutex(h->mutex);
+
+            return h;
+        } // prepare_segment
+
+        static auto init_mutex(pthread_mutex_t& _mutex) -> void
+        {
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+
+            const auto ec = pthread_mutex_init(&_mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+
+            if (ec != 0) {
+                throw std::system_error{ec, std::generic_category(), "shared_buffer_resource: could not initialize mutex"};
+            }
+        } // init_mutex
+
+        segment_header* segment_;
+    }; // shared_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_SHARED_BUFFER_RESOURCE_HPP
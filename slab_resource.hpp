@@ -0,0 +1,449 @@
+#ifndef IRODS_SLAB_RESOURCE_HPP
+#define IRODS_SLAB_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+
+namespace irods::experimental::pmr
+{
+    /// A \p slab_resource is a memory resource that serves small objects from slabs allocated
+    /// from an upstream resource, without storing any metadata next to the objects.
+    ///
+    /// Requests of up to \p max_object_size bytes are rounded up to one of a few size classes.
+    /// Each slab holds objects of a single size class and tracks them in a bitmap at the front
+    /// of the slab. Slabs are aligned to their size, so the slab owning an object is found by
+    /// masking the object's address. Larger requests and alignments the size class cannot
+    /// honor are passed to the upstream resource.
+    ///
+    /// Layering a \p slab_resource over a \p fixed_buffer_resource keeps the cap of the buffer
+    /// while removing the header every allocation from the buffer carries. A slab is returned
+    /// to the upstream resource as soon as it is empty, unless it is the last slab of its size
+    /// class with unused objects. \p release() returns those as well.
+    ///
+    /// This class is NOT thread-safe.
+    ///
+    /// \since 4.2.11
+    class slab_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// The largest request served from a slab.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t max_object_size = 256;
+
+        /// The slab size used unless another one is given on construction.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t default_slab_size = 64 * 1024;
+
+        /// The number of bytes by which every slab falls short of its alignment.
+        ///
+        /// Resources that put a header in front of every allocation (e.g.
+        /// \p fixed_buffer_resource) can then place the next slab directly behind the previous
+        /// one. A slab exactly as large as its alignment would leave a gap of almost a whole
+        /// slab in between.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t slab_reserve = alignof(std::max_align_t);
+
+        /// Constructs a \p slab_resource.
+        ///
+        /// \param[in] _upstream  The resource slabs and large requests are allocated from.
+        /// \param[in] _slab_size The alignment of each slab in bytes. Must be a power of two
+        ///                       of at least 4096 bytes. Slabs are \p slab_reserve bytes
+        ///                       smaller than their alignment.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        explicit slab_resource(boost::container::pmr::memory_resource* _upstream,
+                               std::size_t _slab_size = default_slab_size)
+            : boost::container::pmr::memory_resource{}
+            , upstream_{_upstream}
+            , slab_size_{_slab_size}
+            , classes_{}
+            , allocated_{}
+        {
+            if (!_upstream ||
+                _slab_size < 4096 ||
+                _slab_size > (std::size_t{1} << 32) ||
+                (_slab_size & (_slab_size - 1)) != 0)
+            {
+                const auto* msg_fmt = "slab_resource: invalid constructor arguments "
+                                      "[upstream={}, slab_size={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, fmt::ptr(_upstream), _slab_size)};
+            }
+
+            for (std::size_t i = 0; i < size_class_count; ++i) {
+                init_size_class(i);
+            }
+        } // slab_resource
+
+        slab_resource(const slab_resource&) = delete;
+        auto operator=(const slab_resource&) -> slab_resource& = delete;
+
+        /// Returns every slab to the upstream resource, including slabs that still hold
+        /// objects.
+        ~slab_resource()
+        {
+            for (auto& c : classes_) {
+                for (auto* list : {c.partial, c.full}) {
+                    while (list) {
+                        auto* s = list;
+                        list = list->next;
+                        upstream_->deallocate(s, slab_size_ - slab_reserve, slab_size_);
+                    }
+                }
+            }
+        } // ~slab_resource
+
+        /// Returns the upstream resource.
+        ///
+        /// \since 4.2.11
+        auto upstream() const noexcept -> boost::container::pmr::memory_resource*
+        {
+            return upstream_;
+        } // upstream
+
+        /// Returns the number of bytes used by the client, including requests that were passed
+        /// to the upstream resource.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto allocated() const noexcept -> std::size_t
+        {
+            return allocated_;
+        } // allocated
+
+        /// Returns the number of slabs held by the resource.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto slab_count() const noexcept -> std::size_t
+        {
+            std::size_t count = 0;
+
+            for (const auto& c : classes_) {
+                count += c.slabs;
+            }
+
+            return count;
+        } // slab_count
+
+        /// Returns every empty slab to the upstream resource.
+        ///
+        /// \since 4.2.11
+        auto release() -> void
+        {
+            for (auto& c : classes_) {
+                for (auto* s = c.partial; s;) {
+                    auto* next = s->next;
+
+                    if (s->free_count == c.capacity) {
+                        unlink(c.partial, s);
+                        free_slab(c, s);
+                    }
+
+                    s = next;
+                }
+            }
+        } // release
+
+        /// Writes the state of every size class that holds slabs to the output stream.
+        ///
+        /// \since 4.2.11
+        auto print(std::ostream& _os) const -> void
+        {
+            _os << fmt::format("Slab Info: {{slab_size={}, slabs={}, allocated={}}}\n", slab_size_ - slab_reserve, slab_count(), allocated_);
+
+            for (std::size_t i = 0; i < size_class_count; ++i) {
+                const auto& c = classes_[i];
+
+                if (c.slabs == 0) {
+                    continue;
+                }
+
+                std::size_t unused = 0;
+
+                for (auto* s = c.partial; s; s = s->next) {
+                    unused += s->free_count;
+                }
+
+                _os << fmt::format("{:>3}. Size Class Info: {{object_size={}, objects_per_slab={}, slabs={}, objects_in_use={}}}\n",
+                                   i,
+                                   c.object_size,
+                                   c.capacity,
+                                   c.slabs,
+                                   c.slabs * c.capacity - unused);
+            }
+        } // print
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            const auto i = size_class_of(_bytes, _alignment);
+
+            if (i == size_class_count) {
+                auto* p = upstream_->allocate(_bytes, _alignment);
+                allocated_ += _bytes;
+                return p;
+            }
+
+            auto& c = classes_[i];
+
+            if (!c.partial) {
+                c.partial = allocate_slab(c, i);
+            }
+
+            auto* s = c.partial;
+            auto* bitmap = bitmap_of(s);
+
+            // Every word in front of "first_free_word" is known to be full.
+            while (bitmap[s->first_free_word] == 0) {
+                ++s->first_free_word;
+            }
+
+            auto& word = bitmap[s->first_free_word];
+            const auto index = s->first_free_word * bits_per_word + lowest_bit_index(word);
+
+            word &= word - 1;
+
+            if (--s->free_count == 0) {
+                unlink(c.partial, s);
+                push_front(c.full, s);
+            }
+
+            allocated_ += _bytes;
+
+            return reinterpret_cast<std::byte*>(s) + c.objects_offset + index * c.object_size;
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            const auto i = size_class_of(_bytes, _alignment);
+
+            allocated_ -= _bytes;
+
+            if (i == size_class_count) {
+                upstream_->deallocate(_p, _bytes, _alignment);
+                return;
+            }
+
+            auto& c = classes_[i];
+            auto* s = slab_of(_p);
+
+            assert(s->class_index == i);
+
+            const auto offset = static_cast<std::size_t>(static_cast<std::byte*>(_p) - reinterpret_cast<std::byte*>(s));
+            const auto index = (offset - c.objects_offset) / c.object_size;
+            const auto word = index / bits_per_word;
+
+            assert(!(bitmap_of(s)[word] & (std::uint64_t{1} << (index % bits_per_word))));
+
+            bitmap_of(s)[word] |= std::uint64_t{1} << (index % bits_per_word);
+
+            if (word < s->first_free_word) {
+                s->first_free_word = static_cast<std::uint32_t>(word);
+            }
+
+            if (s->free_count++ == 0) {
+                unlink(c.full, s);
+                push_front(c.partial, s);
+            }
+            else if (s->free_count == c.capacity && (c.partial != s || s->next)) {
+                // Keep the cap meaningful, but not at the cost of allocating a new slab for
+                // the next request of this size class.
+                unlink(c.partial, s);
+                free_slab(c, s);
+            }
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        // Lives at the beginning of every slab and is followed by the bitmap (one bit per
+        // object, set if the object is unused) and the objects.
+        //
+        //     +------+--------+---------+---------+-----+
+        //     | slab | bitmap | object0 | object1 | ... |
+        //     +------+--------+---------+---------+-----+
+        //
+        struct slab
+        {
+            slab* prev;
+            slab* next;
+            std::uint32_t class_index;
+            std::uint32_t free_count;       // Number of unused objects.
+            std::uint32_t first_free_word;  // No bitmap word in front of this one has a bit set.
+        }; // struct slab
+
+        struct size_class
+        {
+            std::size_t object_size;
+            std::size_t capacity;        // Objects per slab.
+            std::size_t bitmap_words;
+            std::size_t objects_offset;  // Offset of the first object from the slab.
+            std::size_t slabs;
+            slab* partial;               // Slabs with unused objects.
+            slab* full;                  // Slabs without unused objects.
+        }; // struct size_class
+
+        static constexpr std::size_t bits_per_word = sizeof(std::uint64_t) * CHAR_BIT;
+
+        // Multiples of 8 bytes up to 64 bytes and multiples of 16 and 32 bytes above that, so
+        // that rounding wastes at most a quarter of an object (roughly).
+        static constexpr std::array<std::size_t, 14> object_sizes{8, 16, 24, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256};
+
+        static constexpr std::size_t size_class_count = object_sizes.size();
+
+        static_assert(object_sizes.back() == max_object_size);
+
+        // The alignment of every object is the largest power of two that divides both the
+        // object size and the alignment of the first object.
+        static constexpr std::size_t max_object_alignment = alignof(std::max_align_t);
+
+        static constexpr auto alignment_of_class(std::size_t _class) noexcept -> std::size_t
+        {
+            const auto size = object_sizes[_class];
+            const auto alignment = size & (~size + 1);
+            return alignment < max_object_alignment ? alignment : max_object_alignment;
+        } // alignment_of_class
+
+        // Returns the size class that serves the request, or "size_class_count" if the
+        // request must be passed to the upstream resource.
+        static auto size_class_of(std::size_t _bytes, std::size_t _alignment) noexcept -> std::size_t
+        {
+            std::size_t i = 0;
+
+            while (i < size_class_count && (object_sizes[i] < _bytes || alignment_of_class(i) < _alignment)) {
+                ++i;
+            }
+
+            return i;
+        } // size_class_of
+
+        static auto lowest_bit_index(std::uint64_t _bits) noexcept -> std::size_t
+        {
+            assert(_bits != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_ctzll(_bits));
+#else
+            std::size_t i = 0;
+            while (!(_bits & 1)) {
+                _bits >>= 1;
+                ++i;
+            }
+            return i;
+#endif
+        } // lowest_bit_index
+
+        static auto bitmap_of(slab* _s) noexcept -> std::uint64_t*
+        {
+            return reinterpret_cast<std::uint64_t*>(reinterpret_cast<std::byte*>(_s) + sizeof(slab));
+        } // bitmap_of
+
+        static auto unlink(slab*& _list, slab* _s) noexcept -> void
+        {
+            if (_s->prev) {
+                _s->prev->next = _s->next;
+            }
+            else {
+                _list = _s->next;
+            }
+
+            if (_s->next) {
+                _s->next->prev = _s->prev;
+            }
+        } // unlink
+
+        static auto push_front(slab*& _list, slab* _s) noexcept -> void
+        {
+            _s->prev = nullptr;
+            _s->next = _list;
+
+            if (_list) {
+                _list->prev = _s;
+            }
+
+            _list = _s;
+        } // push_front
+
+        // Computes the layout of the slabs of size class "_class". The bitmap shrinks as the
+        // number of objects does, so the largest count that fits is searched downward.
+        auto init_size_class(std::size_t _class) noexcept -> void
+        {
+            auto& c = classes_[_class];
+
+            c.object_size = object_sizes[_class];
+            c.capacity = (slab_size_ - slab_reserve - sizeof(slab)) / c.object_size;
+
+            const auto layout = [this, &c] {
+                c.bitmap_words = (c.capacity + bits_per_word - 1) / bits_per_word;
+                const auto end_of_bitmap = sizeof(slab) + c.bitmap_words * sizeof(std::uint64_t);
+                c.objects_offset = (end_of_bitmap + max_object_alignment - 1) & ~(max_object_alignment - 1);
+                return c.objects_offset + c.capacity * c.object_size <= slab_size_ - slab_reserve;
+            };
+
+            while (!layout()) {
+                --c.capacity;
+            }
+        } // init_size_class
+
+        auto slab_of(void* _p) const noexcept -> slab*
+        {
+            return reinterpret_cast<slab*>(reinterpret_cast<std::uintptr_t>(_p) & ~(slab_size_ - 1));
+        } // slab_of
+
+        auto allocate_slab(size_class& _c, std::size_t _class) -> slab*
+        {
+            auto* s = new (upstream_->allocate(slab_size_ - slab_reserve, slab_size_)) slab{};
+            s->class_index = static_cast<std::uint32_t>(_class);
+            s->free_count = static_cast<std::uint32_t>(_c.capacity);
+
+            // Mark every object unused. The bits past the last object stay clear.
+            auto* bitmap = bitmap_of(s);
+
+            for (std::size_t i = 0; i < _c.bitmap_words; ++i) {
+                const auto remaining = _c.capacity - i * bits_per_word;
+                bitmap[i] = remaining >= bits_per_word ? ~std::uint64_t{0} : (std::uint64_t{1} << remaining) - 1;
+            }
+
+            ++_c.slabs;
+
+            return s;
+        } // allocate_slab
+
+        auto free_slab(size_class& _c, slab* _s) -> void
+        {
+            --_c.slabs;
+            upstream_->deallocate(_s, slab_size_ - slab_reserve, slab_size_);
+        } // free_slab
+
+        boost::container::pmr::memory_resource* upstream_;
+        std::size_t slab_size_;
+        std::array<size_class, size_class_count> classes_;
+        std::size_t allocated_;
+    }; // slab_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_SLAB_RESOURCE_HPP
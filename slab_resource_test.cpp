@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "fixed_buffer_resource.hpp"
+#include "slab_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    constexpr std::size_t slab_size = 4096;
+    constexpr std::size_t slab_bytes = slab_size - ie::slab_resource::slab_reserve;
+    constexpr std::size_t object_size = 32;
+
+    // Allocates objects until "_slabs" slabs are full, and returns the objects.
+    auto fill_slabs(ie::slab_resource& _resource, std::size_t _slabs) -> std::vector<void*>
+    {
+        std::vector<void*> objects;
+
+        for (;;) {
+            auto* p = _resource.allocate(object_size);
+
+            if (_resource.slab_count() > _slabs) {
+                // The new slab is empty again, but kept until it is released.
+                _resource.deallocate(p, object_size);
+                _resource.release();
+                return objects;
+            }
+
+            objects.push_back(p);
+        }
+    }
+
+    auto test_random_frees_return_slabs() -> void
+    {
+        std::vector<std::byte> buffer(1024 * 1024);
+        ie::fixed_buffer_resource upstream{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        {
+            ie::slab_resource resource{&upstream, slab_size};
+
+            auto objects = fill_slabs(resource, 4);
+
+            check(resource.slab_count() == 4, "four slabs were filled");
+            check(upstream.allocated() == 4 * slab_bytes, "the slabs were allocated from the buffer");
+            check(resource.allocated() == objects.size() * object_size, "allocated() counts every object");
+
+            std::mt19937 rng{42};
+            std::shuffle(std::begin(objects), std::end(objects), rng);
+
+            for (std::size_t i = 0; i < objects.size(); ++i) {
+                resource.deallocate(objects[i], object_size);
+                check(upstream.allocated() == resource.slab_count() * slab_bytes, "the buffer holds exactly the slabs");
+            }
+
+            check(resource.allocated() == 0, "nothing is allocated");
+            check(resource.slab_count() == 1, "only the last slab with unused objects was kept");
+
+            resource.release();
+
+            check(resource.slab_count() == 0, "release() returned the last slab");
+            check(upstream.allocated() == 0, "every slab was returned to the buffer");
+        }
+
+        check(upstream.is_consistent(), "the buffer is consistent");
+    }
+
+    auto test_freed_slots_are_reused() -> void
+    {
+        std::vector<std::byte> buffer(1024 * 1024);
+        ie::fixed_buffer_resource upstream{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+        ie::slab_resource resource{&upstream, slab_size};
+
+        std::vector<void*> objects;
+
+        for (int i = 0; i < 100; ++i) {
+            objects.push_back(resource.allocate(object_size));
+        }
+
+        check(resource.slab_count() == 1, "the objects share a slab");
+
+        // The lowest unused slot is handed out first.
+        resource.deallocate(objects[70], object_size);
+        resource.deallocate(objects[10], object_size);
+
+        check(resource.allocate(object_size) == objects[10], "the lowest freed slot was reused");
+        check(resource.allocate(object_size) == objects[70], "the next freed slot was reused");
+        check(resource.slab_count() == 1, "no slab was added");
+
+        for (auto* p : objects) {
+            resource.deallocate(p, object_size);
+        }
+
+        check(resource.allocated() == 0, "nothing is allocated");
+    }
+
+    auto test_full_slab_becomes_usable_again() -> void
+    {
+        std::vector<std::byte> buffer(1024 * 1024);
+        ie::fixed_buffer_resource upstream{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+        ie::slab_resource resource{&upstream, slab_size};
+
+        auto objects = fill_slabs(resource, 2);
+
+        // Freeing one object of the full first slab makes it the one requests are served from.
+        resource.deallocate(objects.front(), object_size);
+        check(resource.allocate(object_size) == objects.front(), "the freed slot of the full slab was reused");
+        check(resource.slab_count() == 2, "no slab was added");
+
+        for (auto* p : objects) {
+            resource.deallocate(p, object_size);
+        }
+
+        resource.release();
+        check(upstream.allocated() == 0, "every slab was returned to the buffer");
+    }
+
+    auto test_large_requests_bypass_slabs() -> void
+    {
+        std::vector<std::byte> buffer(1024 * 1024);
+        ie::fixed_buffer_resource upstream{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+        ie::slab_resource resource{&upstream, slab_size};
+
+        auto* large = resource.allocate(ie::slab_resource::max_object_size + 1);
+        auto* aligned = resource.allocate(24, 64);
+
+        check(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0, "the over-aligned request is aligned");
+        check(resource.slab_count() == 0, "neither request was served from a slab");
+        check(upstream.allocated() == ie::slab_resource::max_object_size + 1 + 24, "both requests went to the buffer");
+        check(resource.allocated() == ie::slab_resource::max_object_size + 1 + 24, "allocated() counts both requests");
+
+        resource.deallocate(aligned, 24, 64);
+        resource.deallocate(large, ie::slab_resource::max_object_size + 1);
+
+        check(resource.allocated() == 0 && upstream.allocated() == 0, "nothing is allocated");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"random_frees_return_slabs", test_random_frees_return_slabs},
+        {"freed_slots_are_reused", test_freed_slots_are_reused},
+        {"full_slab_becomes_usable_again", test_full_slab_becomes_usable_again},
+        {"large_requests_bypass_slabs", test_large_requests_bypass_slabs}
+    });
+}
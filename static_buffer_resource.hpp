@@ -0,0 +1,109 @@
+#ifndef IRODS_STATIC_BUFFER_RESOURCE_HPP
+#define IRODS_STATIC_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace irods::experimental::pmr
+{
+    namespace detail
+    {
+        // Owns the buffer of a static_buffer_resource. This is a separate base class so that
+        // the buffer exists before the resource is constructed on top of it. The buffer is
+        // left uninitialized.
+        template <std::size_t Size, std::size_t Alignment>
+        class static_buffer
+        {
+        protected:
+            static_buffer() = default;
+
+            static_buffer(const static_buffer&) = delete;
+            auto operator=(const static_buffer&) -> static_buffer& = delete;
+
+            ~static_buffer() = default;
+
+            alignas(Alignment) std::byte buffer_[Size];
+        }; // class static_buffer
+    } // namespace detail
+
+    /// A \p static_buffer_resource is a \p fixed_buffer_resource that embeds a buffer of
+    /// \p Size bytes, for components whose memory cap is known at compile time.
+    ///
+    /// The buffer is aligned for the block layout, so no bytes are lost to alignment and the
+    /// amount of usable memory (see \p capacity) is known at compile time. Requests aligned
+    /// to more than \p MaxAlign bytes are rejected.
+    ///
+    /// This class is NOT thread-safe. Large buffers should not be placed on the stack.
+    ///
+    /// \tparam Size     The size of the embedded buffer in bytes.
+    /// \tparam MaxAlign The strictest alignment requested from this resource. Must be a power
+    ///                  of two no greater than \p alignof(std::max_align_t).
+    ///
+    /// \since 4.2.11
+    template <std::size_t Size, std::size_t MaxAlign = alignof(std::max_align_t)>
+    class static_buffer_resource
+        : private detail::static_buffer<Size, alignof(std::max_align_t)>
+        , public fixed_buffer_resource<std::byte>
+    {
+    public:
+        static_assert(MaxAlign > 0 && (MaxAlign & (MaxAlign - 1)) == 0,
+                      "The alignment must be a power of two.");
+
+        static_assert(MaxAlign <= block_alignment,
+                      "Requests must not need more alignment than the blocks provide.");
+
+        static_assert(Size >= header_size + block_alignment && Size <= std::numeric_limits<std::int64_t>::max(),
+                      "The buffer must be able to hold a single block.");
+
+        /// The number of unused bytes after construction, which is the size of a single
+        /// block covering the whole buffer.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t capacity = (Size - header_size) & ~(block_alignment - 1);
+
+        /// Constructs a \p static_buffer_resource.
+        ///
+        /// \param[in] _strategy The algorithm used to locate unused memory. Defaults to TLSF so
+        ///                      that allocation runs in constant time.
+        ///
+        /// \since 4.2.11
+        explicit static_buffer_resource(allocation_strategy _strategy = allocation_strategy::two_level_segregated_fit)
+            : detail::static_buffer<Size, alignof(std::max_align_t)>{}
+            , fixed_buffer_resource<std::byte>{this->buffer_, static_cast<std::int64_t>(Size), _strategy}
+        {
+        } // static_buffer_resource
+
+        static_buffer_resource(const static_buffer_resource&) = delete;
+        auto operator=(const static_buffer_resource&) -> static_buffer_resource& = delete;
+
+        ~static_buffer_resource() = default;
+
+    protected:
+        // Stricter alignments than "MaxAlign" break the contract of this class.
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            if (_alignment > MaxAlign) {
+                throw std::bad_alloc{};
+            }
+
+            return fixed_buffer_resource::do_allocate(_bytes, _alignment);
+        } // do_allocate
+
+        auto do_allocate_bulk(std::size_t _count, std::size_t _bytes, std::size_t _alignment, void** _out) -> void override
+        {
+            if (_alignment > MaxAlign) {
+                throw std::bad_alloc{};
+            }
+
+            fixed_buffer_resource::do_allocate_bulk(_count, _bytes, _alignment, _out);
+        } // do_allocate_bulk
+    }; // static_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_STATIC_BUFFER_RESOURCE_HPP
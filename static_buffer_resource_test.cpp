@@ -0,0 +1,130 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "static_buffer_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    constexpr std::size_t buffer_size = 64 * 1024;
+
+    using resource_type = ie::static_buffer_resource<buffer_size>;
+
+    // The buffer is aligned for the block layout, so only the header of the single block is
+    // lost. A size that is not a multiple of the block alignment loses the remainder.
+    static_assert(resource_type::capacity == buffer_size - 16);
+    static_assert(ie::static_buffer_resource<1000>::capacity == 976);
+
+    // TLSF rounds requests up to the next size class, so only first fit can hand out the
+    // whole capacity in one block.
+    auto test_capacity_is_usable() -> void
+    {
+        auto resource = std::make_unique<resource_type>(ie::allocation_strategy::first_fit);
+
+        check(resource->free_bytes() == resource_type::capacity, "the whole capacity is unused");
+        check(resource->largest_free_block() == resource_type::capacity, "the capacity is a single block");
+
+        auto* p = resource->allocate(resource_type::capacity);
+        check(resource->allocated() == resource_type::capacity, "allocated() counts the whole capacity");
+        check(resource->free_bytes() == 0, "no unused memory is left");
+
+        resource->deallocate(p, resource_type::capacity);
+        check(resource->allocated() == 0, "nothing is allocated");
+        check(resource->free_bytes() == resource_type::capacity, "the capacity was restored");
+    }
+
+    auto test_exhaustion_and_recovery() -> void
+    {
+        auto resource = std::make_unique<resource_type>();
+
+        bool rejected = false;
+
+        try {
+            resource->allocate(resource_type::capacity + 1);
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "a request larger than the capacity was rejected");
+        check(resource->allocated() == 0 && resource->is_consistent(), "the rejected request left no trace");
+
+        std::vector<void*> blocks;
+
+        try {
+            for (;;) {
+                blocks.push_back(resource->allocate(100));
+            }
+        }
+        catch (const std::bad_alloc&) {
+        }
+
+        check(!blocks.empty(), "the buffer held some blocks");
+        check(resource->allocated() == blocks.size() * 100, "allocated() counts every block");
+        check(resource->is_consistent(), "the full resource is consistent");
+
+        for (auto* p : blocks) {
+            resource->deallocate(p, 100);
+        }
+
+        check(resource->allocated() == 0, "nothing is allocated");
+        check(resource->is_consistent(), "the resource is consistent");
+        check(resource->free_block_count() == 1, "the unused memory was merged into one block");
+        check(resource->free_bytes() == resource_type::capacity, "the capacity was restored");
+    }
+
+    auto test_stricter_alignment_is_rejected() -> void
+    {
+        ie::static_buffer_resource<4096, 8> resource;
+
+        auto* p = resource.allocate(24, 8);
+        check(reinterpret_cast<std::uintptr_t>(p) % 8 == 0, "the allocation is aligned");
+
+        bool rejected = false;
+
+        try {
+            resource.allocate(24, 16);
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "a request aligned to more than MaxAlign was rejected");
+
+        void* blocks[4];
+        rejected = false;
+
+        try {
+            resource.allocate_bulk(4, 24, 16, blocks);
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "a bulk request aligned to more than MaxAlign was rejected");
+        check(resource.allocated() == 24 && resource.is_consistent(), "the rejected requests left no trace");
+
+        resource.allocate_bulk(4, 24, 8, blocks);
+        resource.deallocate_bulk(blocks, 4, 24, 8);
+        resource.deallocate(p, 24, 8);
+
+        check(resource.allocated() == 0, "nothing is allocated");
+        check(resource.free_bytes() == decltype(resource)::capacity, "the capacity was restored");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"capacity_is_usable", test_capacity_is_usable},
+        {"exhaustion_and_recovery", test_exhaustion_and_recovery},
+        {"stricter_alignment_is_rejected", test_stricter_alignment_is_rejected}
+    });
+}
@@ -0,0 +1,169 @@
+#ifndef IRODS_SYNCHRONIZED_CAPPED_MEMORY_POOL_HPP
+#define IRODS_SYNCHRONIZED_CAPPED_MEMORY_POOL_HPP
+
+/// \file
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+namespace irods::experimental::pmr
+{
+    /// A \p synchronized_capped_memory_pool is a thread-safe memory resource that forwards
+    /// requests to an upstream resource for as long as the total number of bytes outstanding
+    /// stays within a fixed cap.
+    ///
+    /// The cap is enforced without a lock. A request first reserves its bytes against the cap
+    /// with a compare-and-swap loop and only then calls the upstream resource. The reservation
+    /// is rolled back if the upstream resource fails. Because the reservation happens first,
+    /// concurrent requests can never push the total past the cap.
+    ///
+    /// \since 4.2.11
+    class synchronized_capped_memory_pool
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Constructs a \p synchronized_capped_memory_pool.
+        ///
+        /// \param[in] _max_size The maximum number of bytes that may be outstanding at once.
+        /// \param[in] _upstream The resource that provides the memory. Must be thread-safe.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        explicit synchronized_capped_memory_pool(std::int64_t _max_size,
+                                                 boost::container::pmr::memory_resource* _upstream =
+                                                     boost::container::pmr::new_delete_resource())
+            : boost::container::pmr::memory_resource{}
+            , max_size_(_max_size)
+            , upstream_{_upstream}
+            , allocated_{}
+            , high_water_mark_{}
+            , failed_allocations_{}
+        {
+            if (_max_size <= 0 || !_upstream) {
+                const auto* msg_fmt = "synchronized_capped_memory_pool: invalid constructor arguments "
+                                      "[max_size={}, upstream={}].";
+                throw std::invalid_argument{fmt::format(msg_fmt, _max_size, fmt::ptr(_upstream))};
+            }
+        } // synchronized_capped_memory_pool
+
+        synchronized_capped_memory_pool(const synchronized_capped_memory_pool&) = delete;
+        auto operator=(const synchronized_capped_memory_pool&) -> synchronized_capped_memory_pool& = delete;
+
+        ~synchronized_capped_memory_pool() = default;
+
+        /// Returns the number of bytes currently allocated by the client.
+        ///
+        /// \since 4.2.11
+        auto allocated() const noexcept -> std::size_t
+        {
+            return allocated_.load(std::memory_order_relaxed);
+        } // allocated
+
+        /// Returns the maximum number of bytes that may be allocated at once.
+        ///
+        /// \since 4.2.11
+        auto max_size() const noexcept -> std::size_t
+        {
+            return max_size_;
+        } // max_size
+
+        /// Returns the largest value \p allocated() has reached.
+        ///
+        /// \since 4.2.11
+        auto high_water_mark() const noexcept -> std::size_t
+        {
+            return high_water_mark_.load(std::memory_order_relaxed);
+        } // high_water_mark
+
+        /// Returns the number of requests that were rejected, either because they would have
+        /// exceeded the cap or because the upstream resource failed.
+        ///
+        /// \since 4.2.11
+        auto failed_allocations() const noexcept -> std::size_t
+        {
+            return failed_allocations_.load(std::memory_order_relaxed);
+        } // failed_allocations
+
+        /// Returns the resource that provides the memory.
+        ///
+        /// \since 4.2.11
+        auto upstream_resource() const noexcept -> boost::container::pmr::memory_resource*
+        {
+            return upstream_;
+        } // upstream_resource
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            const auto new_total = reserve(_bytes);
+
+            void* p = nullptr;
+
+            try {
+                p = upstream_->allocate(_bytes, _alignment);
+            }
+            catch (...) {
+                allocated_.fetch_sub(_bytes, std::memory_order_relaxed);
+                failed_allocations_.fetch_add(1, std::memory_order_relaxed);
+                throw;
+            }
+
+            // Only contended when a new peak is being set.
+            auto peak = high_water_mark_.load(std::memory_order_relaxed);
+            while (new_total > peak && !high_water_mark_.compare_exchange_weak(peak, new_total, std::memory_order_relaxed)) {
+            }
+
+            return p;
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            upstream_->deallocate(_p, _bytes, _alignment);
+            allocated_.fetch_sub(_bytes, std::memory_order_relaxed);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        // Charges "_bytes" against the cap and returns the new total. Throws std::bad_alloc
+        // without charging anything if the cap would be exceeded.
+        auto reserve(std::size_t _bytes) -> std::size_t
+        {
+            auto current = allocated_.load(std::memory_order_relaxed);
+
+            do {
+                if (_bytes > max_size_ - current) {
+                    failed_allocations_.fetch_add(1, std::memory_order_relaxed);
+                    throw std::bad_alloc{};
+                }
+            }
+            while (!allocated_.compare_exchange_weak(current, current + _bytes, std::memory_order_relaxed));
+
+            return current + _bytes;
+        } // reserve
+
+        const std::size_t max_size_;
+        boost::container::pmr::memory_resource* const upstream_;
+
+        // The counters live on separate cache lines so that readers of the statistics do not
+        // slow down the hot path.
+        alignas(64) std::atomic<std::size_t> allocated_;
+        alignas(64) std::atomic<std::size_t> high_water_mark_;
+        std::atomic<std::size_t> failed_allocations_;
+    }; // synchronized_capped_memory_pool
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_SYNCHRONIZED_CAPPED_MEMORY_POOL_HPP
@@ -0,0 +1,156 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include "synchronized_capped_memory_pool.hpp"
+#include "test_support.hpp"
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    // Records the bytes outstanding upstream and their peak. Fails every request once
+    // "fail" is set.
+    class counting_resource
+        : public pmr::memory_resource
+    {
+    public:
+        std::atomic<std::size_t> outstanding{};
+        std::atomic<std::size_t> peak{};
+        std::atomic<bool> fail{};
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            if (fail.load()) {
+                throw std::bad_alloc{};
+            }
+
+            auto* p = pmr::new_delete_resource()->allocate(_bytes, _alignment);
+            const auto total = outstanding.fetch_add(_bytes) + _bytes;
+
+            auto current = peak.load();
+            while (total > current && !peak.compare_exchange_weak(current, total)) {
+            }
+
+            return p;
+        }
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            outstanding.fetch_sub(_bytes);
+            pmr::new_delete_resource()->deallocate(_p, _bytes, _alignment);
+        }
+
+        auto do_is_equal(const pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        }
+    }; // class counting_resource
+
+    auto test_cap_holds_under_contention() -> void
+    {
+        constexpr std::size_t cap = 64 * 1024;
+        constexpr int thread_count = 8;
+
+        counting_resource upstream;
+        ie::synchronized_capped_memory_pool pool{cap, &upstream};
+
+        std::atomic<std::size_t> max_seen{};
+
+        const auto work = [&](unsigned _seed) {
+            std::mt19937 rng{_seed};
+            std::uniform_int_distribution<std::size_t> size{1, 4096};
+            std::vector<std::pair<void*, std::size_t>> live;
+
+            for (int i = 0; i < 20'000; ++i) {
+                if (live.empty() || rng() % 2 == 0) {
+                    const auto bytes = size(rng);
+
+                    try {
+                        live.emplace_back(pool.allocate(bytes), bytes);
+                    }
+                    catch (const std::bad_alloc&) {
+                    }
+
+                    const auto seen = pool.allocated();
+                    auto current = max_seen.load();
+                    while (seen > current && !max_seen.compare_exchange_weak(current, seen)) {
+                    }
+                }
+                else {
+                    pool.deallocate(live.back().first, live.back().second);
+                    live.pop_back();
+                }
+            }
+
+            for (auto [p, bytes] : live) {
+                pool.deallocate(p, bytes);
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < thread_count; ++i) {
+            threads.emplace_back(work, static_cast<unsigned>(i));
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        check(pool.failed_allocations() > 0, "the cap was reached");
+        check(max_seen.load() <= cap, "allocated() never exceeded the cap");
+        check(pool.high_water_mark() <= cap, "the high water mark is within the cap");
+        check(upstream.peak.load() <= cap, "the upstream resource never held more than the cap");
+        check(pool.allocated() == 0, "allocated() returned to zero");
+        check(upstream.outstanding.load() == 0, "everything was returned upstream");
+    }
+
+    auto test_upstream_failure_releases_reservation() -> void
+    {
+        counting_resource upstream;
+        ie::synchronized_capped_memory_pool pool{1024, &upstream};
+
+        auto* p = pool.allocate(100);
+        upstream.fail = true;
+
+        bool rejected = false;
+
+        try {
+            pool.allocate(100);
+        }
+        catch (const std::bad_alloc&) {
+            rejected = true;
+        }
+
+        check(rejected, "the upstream failure was passed on");
+        check(pool.failed_allocations() == 1, "the failure was counted");
+        check(pool.allocated() == 100, "the reservation was rolled back");
+
+        upstream.fail = false;
+        pool.deallocate(p, 100);
+
+        check(pool.allocated() == 0, "allocated() returned to zero");
+        check(pool.high_water_mark() == 100, "the high water mark only counts successful requests");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"cap_holds_under_contention", test_cap_holds_under_contention},
+        {"upstream_failure_releases_reservation", test_upstream_failure_releases_reservation}
+    });
+}
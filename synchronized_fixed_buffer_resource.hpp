@@ -0,0 +1,451 @@
+#ifndef IRODS_SYNCHRONIZED_FIXED_BUFFER_RESOURCE_HPP
+#define IRODS_SYNCHRONIZED_FIXED_BUFFER_RESOURCE_HPP
+
+/// \file
+
+#include "fixed_buffer_resource.hpp"
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace irods::experimental::pmr
+{
+    /// A \p synchronized_fixed_buffer_resource is a thread-safe counterpart of
+    /// \p fixed_buffer_resource. All memory still comes from the single buffer given on
+    /// construction, so the cap applies to every thread combined.
+    ///
+    /// Small requests are served from per-thread caches (magazines) of fixed-size blocks.
+    /// A cache is refilled from, and trimmed back to, the shared \p fixed_buffer_resource in
+    /// batches, so the lock protecting the buffer is only taken once per batch. Memory released
+    /// by a thread is kept in that thread's cache regardless of which thread allocated it, which
+    /// means cross-thread deallocations are returned to the buffer lazily. When a thread exits,
+    /// the cache it used is returned to the buffer.
+    ///
+    /// Blocks held by the caches count against the cap. When the buffer cannot satisfy a
+    /// request, every cache is flushed and the request is retried before \p std::bad_alloc is
+    /// thrown.
+    ///
+    /// \tparam ByteRep The memory representation for the underlying buffer. Must be one of
+    ///                 the following:
+    /// - char
+    /// - unsigned char
+    /// - std::byte
+    ///
+    /// \since 4.2.11
+    template <typename ByteRep>
+    class synchronized_fixed_buffer_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// Requests larger than this many bytes bypass the caches.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t max_cached_size = 512;
+
+        /// Constructs a \p synchronized_fixed_buffer_resource using the given buffer as the
+        /// allocation source.
+        ///
+        /// \param[in] _buffer      The buffer that will be used for allocations.
+        /// \param[in] _buffer_size The size of the buffer in bytes.
+        /// \param[in] _strategy    The algorithm used by the shared \p fixed_buffer_resource.
+        ///
+        /// \throws std::invalid_argument If any of the incoming constructor arguments do not
+        ///                               satisfy construction requirements.
+        ///
+        /// \since 4.2.11
+        synchronized_fixed_buffer_resource(ByteRep* _buffer,
+                                           std::int64_t _buffer_size,
+                                           allocation_strategy _strategy = allocation_strategy::segregated_fit)
+            : boost::container::pmr::memory_resource{}
+            , upstream_{_buffer, _buffer_size, _strategy}
+            , upstream_mutex_{}
+            , cache_count_{default_cache_count()}
+            , caches_{std::make_unique<cache[]>(cache_count_)}
+            , uncached_allocated_{}
+            , registration_{std::make_shared<registration>()}
+        {
+            registration_->resource = this;
+        } // synchronized_fixed_buffer_resource
+
+        synchronized_fixed_buffer_resource(const synchronized_fixed_buffer_resource&) = delete;
+        auto operator=(const synchronized_fixed_buffer_resource&) -> synchronized_fixed_buffer_resource& = delete;
+
+        ~synchronized_fixed_buffer_resource()
+        {
+            // Threads that exit from now on must not touch this object.
+            std::lock_guard lock{registration_->mutex};
+            registration_->resource = nullptr;
+        } // ~synchronized_fixed_buffer_resource
+
+        /// Returns the number of bytes used by the client.
+        ///
+        /// The value returned does not include memory held by the caches or memory used for
+        /// tracking allocations. It is a snapshot when other threads are allocating.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto allocated() const noexcept -> std::size_t
+        {
+            // The per-cache counters wrap when a thread releases memory allocated by another
+            // thread. Unsigned arithmetic makes the sum come out right anyway.
+            auto sum = uncached_allocated_.load(std::memory_order_relaxed);
+
+            for (std::size_t i = 0; i < cache_count_; ++i) {
+                sum += caches_[i].allocated.load(std::memory_order_relaxed);
+            }
+
+            return sum;
+        } // allocated
+
+        /// Returns the number of bytes held by the caches.
+        ///
+        /// \return An unsigned integral type.
+        ///
+        /// \since 4.2.11
+        auto cached() const -> std::size_t
+        {
+            std::size_t sum = 0;
+
+            for (std::size_t i = 0; i < cache_count_; ++i) {
+                auto& c = caches_[i];
+                std::lock_guard lock{c.mutex};
+
+                for (std::size_t j = 0; j < size_class_count; ++j) {
+                    sum += c.counts[j] * size_of_class(j);
+                }
+            }
+
+            return sum;
+        } // cached
+
+        /// Returns every block held by the caches to the buffer.
+        ///
+        /// \since 4.2.11
+        auto release() -> void
+        {
+            for (std::size_t i = 0; i < cache_count_; ++i) {
+                flush(caches_[i]);
+            }
+        } // release
+
+        /// Verifies the allocation table of the shared buffer while holding its lock (see
+        /// \p fixed_buffer_resource::is_consistent()).
+        ///
+        /// \return A boolean value indicating whether the state of the buffer is intact.
+        ///
+        /// \since 4.2.11
+        auto is_consistent() const -> bool
+        {
+            std::lock_guard lock{upstream_mutex_};
+            return upstream_.is_consistent();
+        } // is_consistent
+
+        /// Writes the state of the allocation table of the shared buffer to the output stream.
+        ///
+        /// \since 4.2.11
+        auto print(std::ostream& _os) const -> void
+        {
+            std::lock_guard lock{upstream_mutex_};
+            upstream_.print(_os);
+        } // print
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            if (!is_cacheable(_bytes, _alignment)) {
+                auto* p = allocate_uncached(_bytes, _alignment);
+                uncached_allocated_.fetch_add(_bytes, std::memory_order_relaxed);
+                return p;
+            }
+
+            const auto i = size_class_of(_bytes);
+            auto& c = local_cache();
+
+            for (bool retry = true;; retry = false) {
+                {
+                    std::lock_guard lock{c.mutex};
+
+                    if (c.lists[i] || refill(c, i)) {
+                        auto* n = c.lists[i];
+                        c.lists[i] = n->next;
+                        --c.counts[i];
+                        c.allocated.store(c.allocated.load(std::memory_order_relaxed) + _bytes, std::memory_order_relaxed);
+                        return n;
+                    }
+                }
+
+                if (!retry) {
+                    throw std::bad_alloc{};
+                }
+
+                // The buffer is exhausted. Other threads may be sitting on unused blocks.
+                release();
+            }
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            if (!is_cacheable(_bytes, _alignment)) {
+                {
+                    std::lock_guard lock{upstream_mutex_};
+                    upstream_.deallocate(_p, _bytes, _alignment);
+                }
+
+                uncached_allocated_.fetch_sub(_bytes, std::memory_order_relaxed);
+                return;
+            }
+
+            const auto i = size_class_of(_bytes);
+            auto& c = local_cache();
+
+            std::lock_guard lock{c.mutex};
+
+            auto* n = new (_p) free_node;
+            n->next = c.lists[i];
+            c.lists[i] = n;
+            c.allocated.store(c.allocated.load(std::memory_order_relaxed) - _bytes, std::memory_order_relaxed);
+
+            if (++c.counts[i] > capacity_of_class(i)) {
+                trim(c, i);
+            }
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        // Cached blocks are linked through their first bytes.
+        struct free_node
+        {
+            free_node* next;
+        }; // struct free_node
+
+        // Cached blocks are rounded up to a multiple of "size_class_granularity".
+        static constexpr std::size_t size_class_granularity = alignof(std::max_align_t);
+        static constexpr std::size_t size_class_count = max_cached_size / size_class_granularity;
+        static constexpr std::size_t block_alignment = alignof(std::max_align_t);
+
+        // The largest number of blocks moved between a cache and the buffer at once (half the
+        // capacity of the smallest size class, see capacity_of_class()).
+        static constexpr std::size_t max_batch_size = 16384 / size_class_granularity / 2;
+
+        // Each cache lives on its own cache lines so threads do not interfere with each other.
+        struct alignas(64) cache
+        {
+            mutable std::mutex mutex;
+            std::array<free_node*, size_class_count> lists{};
+            std::array<std::size_t, size_class_count> counts{};
+            // Bytes handed out minus bytes released through this cache, by every thread mapped
+            // to it (including releases of memory allocated through other caches). Only
+            // written under "mutex". Atomic because allocated() reads it without the lock.
+            std::atomic<std::size_t> allocated{};
+        }; // struct cache
+
+        // Lets the threads that used a resource flush their cache when they exit, without
+        // keeping the resource alive. "resource" is null once the resource is destroyed.
+        struct registration
+        {
+            std::mutex mutex;
+            synchronized_fixed_buffer_resource* resource = nullptr;
+        }; // struct registration
+
+        // The resources used by a thread. Destroyed when the thread exits.
+        struct thread_exit_flush
+        {
+            ~thread_exit_flush()
+            {
+                for (const auto& r : registrations) {
+                    if (const auto reg = r.lock(); reg) {
+                        std::lock_guard lock{reg->mutex};
+
+                        if (reg->resource) {
+                            reg->resource->flush(reg->resource->local_cache_unregistered());
+                        }
+                    }
+                }
+            }
+
+            std::vector<std::weak_ptr<registration>> registrations;
+            const registration* last = nullptr;  // Skips the search while one resource is used.
+        }; // struct thread_exit_flush
+
+        static auto default_cache_count() -> std::size_t
+        {
+            return std::max(1u, std::thread::hardware_concurrency()) * 2;
+        } // default_cache_count
+
+        static constexpr auto is_cacheable(std::size_t _bytes, std::size_t _alignment) noexcept -> bool
+        {
+            return _bytes <= max_cached_size && _alignment <= block_alignment;
+        } // is_cacheable
+
+        static constexpr auto size_class_of(std::size_t _bytes) noexcept -> std::size_t
+        {
+            return (std::max<std::size_t>(_bytes, 1) + size_class_granularity - 1) / size_class_granularity - 1;
+        } // size_class_of
+
+        static constexpr auto size_of_class(std::size_t _class) noexcept -> std::size_t
+        {
+            return (_class + 1) * size_class_granularity;
+        } // size_of_class
+
+        // The number of blocks a cache may hold for a size class. Small blocks are cached in
+        // larger numbers so that each cache holds roughly the same number of bytes per class.
+        static constexpr auto capacity_of_class(std::size_t _class) noexcept -> std::size_t
+        {
+            return std::max<std::size_t>(16, 16384 / size_of_class(_class));
+        } // capacity_of_class
+
+        auto local_cache() -> cache&
+        {
+            static thread_local thread_exit_flush exit_flush;
+
+            if (exit_flush.last != registration_.get()) {
+                auto& regs = exit_flush.registrations;
+                const auto is_this = [this](const auto& _r) { return _r.lock() == registration_; };
+
+                if (std::none_of(std::begin(regs), std::end(regs), is_this)) {
+                    regs.erase(std::remove_if(std::begin(regs), std::end(regs), [](const auto& _r) { return _r.expired(); }),
+                               std::end(regs));
+                    regs.push_back(registration_);
+                }
+
+                // The registration outlives the weak pointer, so its address is not reused
+                // while it is remembered here.
+                exit_flush.last = registration_.get();
+            }
+
+            return local_cache_unregistered();
+        } // local_cache
+
+        auto local_cache_unregistered() noexcept -> cache&
+        {
+            // Threads are assigned caches round-robin the first time they touch any instance,
+            // so collisions only happen once there are more threads than caches.
+            static std::atomic<std::size_t> next_index{0};
+            static thread_local const std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+
+            return caches_[index % cache_count_];
+        } // local_cache_unregistered
+
+        // Returns every block held by the cache to the buffer.
+        auto flush(cache& _c) -> void
+        {
+            std::array<free_node*, size_class_count> lists;
+
+            {
+                std::lock_guard lock{_c.mutex};
+                lists = _c.lists;
+                _c.lists.fill(nullptr);
+                _c.counts.fill(0);
+            }
+
+            std::lock_guard lock{upstream_mutex_};
+
+            for (std::size_t j = 0; j < size_class_count; ++j) {
+                for (auto* n = lists[j]; n;) {
+                    auto* next = n->next;
+                    upstream_.deallocate(n, size_of_class(j), block_alignment);
+                    n = next;
+                }
+            }
+        } // flush
+
+        auto allocate_uncached(std::size_t _bytes, std::size_t _alignment) -> void*
+        {
+            try {
+                std::lock_guard lock{upstream_mutex_};
+                return upstream_.allocate(_bytes, _alignment);
+            }
+            catch (const std::bad_alloc&) {
+                release();
+            }
+
+            std::lock_guard lock{upstream_mutex_};
+            return upstream_.allocate(_bytes, _alignment);
+        } // allocate_uncached
+
+        // Moves up to half a magazine of blocks from the buffer into the cache. Returns false if
+        // the buffer could not provide a single block. The caller must hold the cache's lock.
+        auto refill(cache& _c, std::size_t _class) -> bool
+        {
+            const auto size = size_of_class(_class);
+            const auto count = capacity_of_class(_class) / 2;
+
+            std::array<void*, max_batch_size> blocks;
+            auto n = count;
+
+            {
+                std::lock_guard lock{upstream_mutex_};
+
+                try {
+                    upstream_.allocate_bulk(count, size, block_alignment, blocks.data());
+                }
+                catch (const std::bad_alloc&) {
+                    // The buffer is nearly exhausted. Take whatever is left.
+                    for (n = 0; n < count; ++n) {
+                        try {
+                            blocks[n] = upstream_.allocate(size, block_alignment);
+                        }
+                        catch (const std::bad_alloc&) {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // Push in reverse so that the blocks are handed out in the order they were carved.
+            while (n > 0) {
+                auto* node = new (blocks[--n]) free_node;
+                node->next = _c.lists[_class];
+                _c.lists[_class] = node;
+                ++_c.counts[_class];
+            }
+
+            return _c.lists[_class] != nullptr;
+        } // refill
+
+        // Returns half a magazine of blocks to the buffer. The caller must hold the cache's lock.
+        auto trim(cache& _c, std::size_t _class) -> void
+        {
+            const auto size = size_of_class(_class);
+            const auto count = capacity_of_class(_class) / 2;
+
+            std::lock_guard lock{upstream_mutex_};
+
+            for (std::size_t n = 0; n < count && _c.lists[_class]; ++n) {
+                auto* node = _c.lists[_class];
+                _c.lists[_class] = node->next;
+                --_c.counts[_class];
+                upstream_.deallocate(node, size, block_alignment);
+            }
+        } // trim
+
+        // Lock ordering: a cache's lock may be held while acquiring "upstream_mutex_", never
+        // the other way around, and at most one cache lock is held at a time.
+        fixed_buffer_resource<ByteRep> upstream_;
+        mutable std::mutex upstream_mutex_;
+        std::size_t cache_count_;
+        std::unique_ptr<cache[]> caches_;
+        std::atomic<std::size_t> uncached_allocated_;
+        std::shared_ptr<registration> registration_;
+    }; // synchronized_fixed_buffer_resource
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_SYNCHRONIZED_FIXED_BUFFER_RESOURCE_HPP
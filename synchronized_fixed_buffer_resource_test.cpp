@@ -0,0 +1,207 @@
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "fixed_buffer_resource.hpp"
+#include "synchronized_fixed_buffer_resource.hpp"
+#include "test_support.hpp"
+
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    using resource_type = ie::synchronized_fixed_buffer_resource<std::byte>;
+
+    constexpr int thread_count = 8;
+
+    auto test_threads_share_the_buffer() -> void
+    {
+        struct allocation
+        {
+            void* p;
+            std::size_t bytes;
+        };
+
+        std::vector<std::byte> buffer(4 * 1024 * 1024);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        // Blocks handed from one thread to another, so that caches receive blocks they did
+        // not allocate.
+        std::mutex handoff_mutex;
+        std::vector<allocation> handoff;
+
+        const auto work = [&](unsigned _seed) {
+            std::mt19937 rng{_seed};
+            std::uniform_int_distribution<std::size_t> size{1, 1024};
+            std::uniform_int_distribution<int> percent{0, 99};
+            std::vector<allocation> live;
+
+            for (int i = 0; i < 20'000; ++i) {
+                if (live.empty() || percent(rng) < 55) {
+                    const auto bytes = size(rng);
+
+                    try {
+                        live.push_back({resource.allocate(bytes), bytes});
+                    }
+                    catch (const std::bad_alloc&) {
+                    }
+                }
+                else if (percent(rng) < 10) {
+                    std::lock_guard lock{handoff_mutex};
+                    handoff.push_back(live.back());
+                    live.pop_back();
+                }
+                else {
+                    const auto a = live.back();
+                    live.pop_back();
+                    resource.deallocate(a.p, a.bytes);
+                }
+
+                if (i % 100 == 0) {
+                    std::lock_guard lock{handoff_mutex};
+
+                    for (const auto& a : handoff) {
+                        resource.deallocate(a.p, a.bytes);
+                    }
+
+                    handoff.clear();
+                }
+            }
+
+            for (const auto& a : live) {
+                resource.deallocate(a.p, a.bytes);
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < thread_count; ++i) {
+            threads.emplace_back(work, static_cast<unsigned>(i));
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        check(resource.cached() == 0, "the caches were flushed when the threads exited");
+        check(resource.is_consistent(), "the buffer is consistent");
+
+        for (const auto& a : handoff) {
+            resource.deallocate(a.p, a.bytes);
+        }
+
+        check(resource.allocated() == 0, "nothing is allocated");
+
+        resource.release();
+        check(resource.cached() == 0, "release() empties the caches");
+        check(resource.is_consistent(), "the buffer is consistent");
+    }
+
+    auto test_thread_exit_flushes_cache() -> void
+    {
+        std::vector<std::byte> buffer(1024 * 1024);
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+        std::size_t cached = 0;
+
+        std::thread{[&resource, &cached] {
+            resource.deallocate(resource.allocate(64), 64);
+            cached = resource.cached();
+        }}.join();
+
+        check(cached > 0, "the deallocated block was cached");
+        check(resource.cached() == 0, "the cache was flushed when the thread exited");
+        check(resource.allocated() == 0, "nothing is allocated");
+        check(resource.is_consistent(), "the buffer is consistent");
+    }
+
+    // A thread that exits after the resource was destroyed must not touch it.
+    auto test_thread_outlives_resource() -> void
+    {
+        std::promise<void> used;
+        std::promise<void> destroyed;
+        std::thread t;
+
+        {
+            std::vector<std::byte> buffer(1024 * 1024);
+            resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer.size())};
+
+            t = std::thread{[&resource, &used, done = destroyed.get_future()] {
+                resource.deallocate(resource.allocate(64), 64);
+                used.set_value();
+                done.wait();
+            }};
+
+            used.get_future().wait();
+        }
+
+        destroyed.set_value();
+        t.join();
+    }
+
+    // When the buffer cannot hold a whole batch, the cache takes the blocks that are left
+    // one by one, so the resource hands out as many blocks as the buffer itself.
+    auto test_refill_takes_remaining_blocks() -> void
+    {
+        constexpr std::size_t buffer_size = 64 * 1024 + 1000;
+        constexpr std::size_t bytes = 16;
+
+        std::vector<std::byte> buffer(buffer_size);
+
+        std::size_t expected = 0;
+
+        {
+            ie::fixed_buffer_resource<std::byte> plain{buffer.data(), static_cast<std::int64_t>(buffer_size),
+                                                       ie::allocation_strategy::segregated_fit};
+
+            try {
+                for (;;) {
+                    plain.allocate(bytes);
+                    ++expected;
+                }
+            }
+            catch (const std::bad_alloc&) {
+            }
+        }
+
+        resource_type resource{buffer.data(), static_cast<std::int64_t>(buffer_size)};
+        std::vector<void*> blocks;
+
+        try {
+            for (;;) {
+                blocks.push_back(resource.allocate(bytes));
+            }
+        }
+        catch (const std::bad_alloc&) {
+        }
+
+        check(blocks.size() == expected, "every block of the buffer was handed out");
+        check(resource.allocated() == blocks.size() * bytes, "allocated() counts every block");
+
+        for (auto* p : blocks) {
+            resource.deallocate(p, bytes);
+        }
+
+        resource.release();
+
+        check(resource.allocated() == 0, "nothing is allocated");
+        check(resource.is_consistent(), "the buffer is consistent");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"threads_share_the_buffer", test_threads_share_the_buffer},
+        {"thread_exit_flushes_cache", test_thread_exit_flushes_cache},
+        {"thread_outlives_resource", test_thread_outlives_resource},
+        {"refill_takes_remaining_blocks", test_refill_takes_remaining_blocks}
+    });
+}
@@ -0,0 +1,105 @@
+#ifndef IRODS_TEST_SUPPORT_HPP
+#define IRODS_TEST_SUPPORT_HPP
+
+/// \file
+///
+/// Helpers shared by the test drivers. Not meant to be used by library code.
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace irods::experimental::pmr::test
+{
+    /// Throws if \p _condition does not hold.
+    ///
+    /// \param[in] _condition The condition to verify.
+    /// \param[in] _what      A description of the condition, reported on failure.
+    ///
+    /// \throws std::runtime_error If \p _condition is false.
+    inline auto check(bool _condition, std::string_view _what) -> void
+    {
+        if (!_condition) {
+            throw std::runtime_error{fmt::format("check failed: {}", _what)};
+        }
+    } // check
+
+    /// A named test.
+    struct test_case
+    {
+        std::string name;
+        std::function<void()> function;
+    }; // struct test_case
+
+    /// Runs the tests in order and stops at the first one that throws.
+    ///
+    /// \return The exit code of the driver.
+    inline auto run(const std::vector<test_case>& _tests) -> int
+    {
+        for (const auto& t : _tests) {
+            try {
+                t.function();
+            }
+            catch (const std::exception& e) {
+                std::cerr << fmt::format("{}: {}\n", t.name, e.what());
+                return 1;
+            }
+        }
+
+        std::cout << "all tests passed\n";
+
+        return 0;
+    } // run
+
+    /// Returns whether \p _func aborts (e.g. through a failed assertion).
+    ///
+    /// \p _func runs in a child process whose standard error is discarded, so that the
+    /// resources of the driver are not affected.
+    ///
+    /// \throws std::system_error If the child process could not be created.
+    template <typename Function>
+    auto aborts(Function _func) -> bool
+    {
+        std::cout.flush();
+        std::cerr.flush();
+
+        const auto pid = ::fork();
+
+        if (pid == -1) {
+            throw std::system_error{errno, std::generic_category(), "test::aborts: fork failed"};
+        }
+
+        if (pid == 0) {
+            if (const auto fd = ::open("/dev/null", O_WRONLY); fd >= 0) {
+                ::dup2(fd, STDERR_FILENO);
+            }
+
+            _func();
+            std::_Exit(0);
+        }
+
+        int status = 0;
+
+        if (::waitpid(pid, &status, 0) == -1) {
+            throw std::system_error{errno, std::generic_category(), "test::aborts: waitpid failed"};
+        }
+
+        return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+    } // aborts
+} // namespace irods::experimental::pmr::test
+
+#endif // IRODS_TEST_SUPPORT_HPP
@@ -0,0 +1,383 @@
+#ifndef IRODS_TRACING_RESOURCE_HPP
+#define IRODS_TRACING_RESOURCE_HPP
+
+/// \file
+
+#include <boost/container/pmr/memory_resource.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace irods::experimental::pmr
+{
+    /// The kind of operation described by a \p trace_record.
+    ///
+    /// \since 4.2.11
+    enum class trace_operation : std::uint8_t
+    {
+        allocate,
+        deallocate
+    }; // enum class trace_operation
+
+    /// A single operation captured by a \p tracing_resource.
+    ///
+    /// \since 4.2.11
+    struct trace_record
+    {
+        /// Whether memory was allocated or deallocated.
+        trace_operation operation;
+
+        /// The number of nanoseconds between the construction of the \p tracing_resource and
+        /// the operation.
+        std::uint64_t timestamp;
+
+        /// Identifies the allocation. Allocations are numbered 1, 2, 3, ... in the order they
+        /// succeeded, and a deallocation carries the number of the allocation it frees.
+        std::uint64_t id;
+
+        /// The size of the allocation in bytes.
+        std::size_t bytes;
+
+        /// The alignment of the allocation. Always a power of two.
+        std::size_t alignment;
+    }; // struct trace_record
+
+    /// Identifies a trace and the version of its format. Every trace starts with these bytes.
+    ///
+    /// \since 4.2.11
+    inline constexpr std::string_view trace_magic{"IRPMRTR1", 8};
+
+    /// A \p tracing_resource is a memory resource decorator that writes every successful
+    /// allocation and deallocation to a binary log, so that the exact sequence of requests
+    /// (sizes, alignments, lifetimes and timing) of a real workload can be replayed against
+    /// other resources later (see \p trace_reader).
+    ///
+    /// The log starts with \p trace_magic and is followed by one record per operation. A record
+    /// is a byte holding the operation in bit 0 and the base-2 logarithm of the alignment in
+    /// the remaining bits, followed by the time since the previous record (in nanoseconds),
+    /// the allocation id and the size, each encoded as an unsigned LEB128 integer. Most records
+    /// take 6 to 8 bytes.
+    ///
+    /// Records are collected in memory and written to the stream whenever \p flush_threshold
+    /// bytes have accumulated, on \p flush() and on destruction. Failed allocations are not
+    /// recorded. Write errors never fail an allocation. Check the state of the stream or call
+    /// \p flush() to detect them.
+    ///
+    /// This class is thread-safe if the upstream resource is. The records of all threads are
+    /// interleaved in the order they acquired an internal lock, which happens after the
+    /// upstream resource has allocated and before it deallocates, so an id is never reused
+    /// while it is live.
+    ///
+    /// \since 4.2.11
+    class tracing_resource
+        : public boost::container::pmr::memory_resource
+    {
+    public:
+        /// The number of buffered bytes that causes the records to be written to the stream.
+        ///
+        /// \since 4.2.11
+        static constexpr std::size_t flush_threshold = 64 * 1024;
+
+        /// Constructs a \p tracing_resource and writes \p trace_magic to \p _log.
+        ///
+        /// \param[in] _upstream The resource being traced.
+        /// \param[in] _log      The binary stream receiving the records. Must outlive this
+        ///                      object.
+        ///
+        /// \throws std::invalid_argument If \p _upstream is null.
+        /// \throws std::runtime_error    If writing to \p _log fails.
+        ///
+        /// \since 4.2.11
+        tracing_resource(boost::container::pmr::memory_resource* _upstream, std::ostream& _log)
+            : boost::container::pmr::memory_resource{}
+            , upstream_{_upstream}
+            , log_{_log}
+            , mtx_{}
+            , buffer_{}
+            , ids_{}
+            , next_id_{1}
+            , start_{clock_type::now()}
+            , last_timestamp_{}
+            , records_{}
+        {
+            if (!_upstream) {
+                throw std::invalid_argument{"tracing_resource: upstream resource is null."};
+            }
+
+            buffer_.reserve(flush_threshold + max_record_size);
+            buffer_.insert(std::end(buffer_), std::begin(trace_magic), std::end(trace_magic));
+            flush();
+        } // tracing_resource
+
+        tracing_resource(const tracing_resource&) = delete;
+        auto operator=(const tracing_resource&) -> tracing_resource& = delete;
+
+        /// Writes the remaining records to the stream. Errors are ignored.
+        ~tracing_resource()
+        {
+            try {
+                flush();
+            }
+            catch (...) {
+            }
+        } // ~tracing_resource
+
+        /// Writes the buffered records to the stream and flushes it.
+        ///
+        /// \throws std::runtime_error If writing to the stream fails.
+        ///
+        /// \since 4.2.11
+        auto flush() -> void
+        {
+            std::lock_guard lk{mtx_};
+
+            write_buffer();
+
+            if (!log_.flush()) {
+                throw std::runtime_error{"tracing_resource: could not write to the trace."};
+            }
+        } // flush
+
+        /// Returns the number of records produced so far.
+        ///
+        /// \since 4.2.11
+        auto records() const -> std::uint64_t
+        {
+            std::lock_guard lk{mtx_};
+            return records_;
+        } // records
+
+        /// Returns the number of traced allocations that have not been deallocated yet.
+        ///
+        /// \since 4.2.11
+        auto live_allocations() const -> std::size_t
+        {
+            std::lock_guard lk{mtx_};
+            return ids_.size();
+        } // live_allocations
+
+    protected:
+        auto do_allocate(std::size_t _bytes, std::size_t _alignment) -> void* override
+        {
+            auto* p = upstream_->allocate(_bytes, _alignment);
+
+            std::lock_guard lk{mtx_};
+
+            try {
+                ids_.emplace(p, next_id_);
+            }
+            catch (...) {
+                upstream_->deallocate(p, _bytes, _alignment);
+                throw;
+            }
+
+            append(trace_operation::allocate, next_id_++, _bytes, _alignment);
+
+            return p;
+        } // do_allocate
+
+        auto do_deallocate(void* _p, std::size_t _bytes, std::size_t _alignment) -> void override
+        {
+            {
+                std::lock_guard lk{mtx_};
+
+                // Pointers this resource did not hand out have no id, and a replay could not
+                // have allocated them, so they are not recorded.
+                if (auto it = ids_.find(_p); it != std::end(ids_)) {
+                    append(trace_operation::deallocate, it->second, _bytes, _alignment);
+                    ids_.erase(it);
+                }
+            }
+
+            upstream_->deallocate(_p, _bytes, _alignment);
+        } // do_deallocate
+
+        auto do_is_equal(const boost::container::pmr::memory_resource& _other) const noexcept -> bool override
+        {
+            return this == &_other;
+        } // do_is_equal
+
+    private:
+        using clock_type = std::chrono::steady_clock;
+
+        // One byte for the operation and three LEB128 integers of at most ten bytes each.
+        static constexpr std::size_t max_record_size = 1 + 3 * 10;
+
+        // Never throws. The buffer has room for a record beyond the threshold, and write
+        // errors are left in the stream's state for flush() to report.
+        auto append(trace_operation _op, std::uint64_t _id, std::size_t _bytes, std::size_t _alignment) noexcept -> void
+        {
+            const auto elapsed = clock_type::now() - start_;
+            const auto timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+            std::uint8_t alignment_log2 = 0;
+
+            while ((std::size_t{1} << alignment_log2) < _alignment) {
+                ++alignment_log2;
+            }
+
+            buffer_.push_back(static_cast<char>(static_cast<std::uint8_t>(_op) | (alignment_log2 << 1)));
+
+            // Timestamps only decrease when threads race between reading the clock and
+            // appending. Those records are written with no delay.
+            append_varint(timestamp > last_timestamp_ ? timestamp - last_timestamp_ : 0);
+            append_varint(_id);
+            append_varint(_bytes);
+
+            last_timestamp_ = std::max(last_timestamp_, timestamp);
+            ++records_;
+
+            if (buffer_.size() >= flush_threshold) {
+                write_buffer();
+            }
+        } // append
+
+        auto append_varint(std::uint64_t _value) noexcept -> void
+        {
+            while (_value >= 0x80) {
+                buffer_.push_back(static_cast<char>((_value & 0x7f) | 0x80));
+                _value >>= 7;
+            }
+
+            buffer_.push_back(static_cast<char>(_value));
+        } // append_varint
+
+        auto write_buffer() noexcept -> void
+        {
+            try {
+                log_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            }
+            catch (...) {
+                // Only streams with exceptions enabled throw, and the stream's state records
+                // the failure either way.
+            }
+
+            buffer_.clear();
+        } // write_buffer
+
+        boost::container::pmr::memory_resource* upstream_;
+        std::ostream& log_;
+        mutable std::mutex mtx_;
+        std::vector<char> buffer_;
+        std::unordered_map<void*, std::uint64_t> ids_;
+        std::uint64_t next_id_;
+        clock_type::time_point start_;
+        std::uint64_t last_timestamp_;
+        std::uint64_t records_;
+    }; // tracing_resource
+
+    /// A \p trace_reader decodes the records written by a \p tracing_resource.
+    ///
+    /// \since 4.2.11
+    class trace_reader
+    {
+    public:
+        /// Constructs a \p trace_reader and consumes \p trace_magic from \p _log.
+        ///
+        /// \param[in] _log The binary stream holding the trace. Must outlive this object.
+        ///
+        /// \throws std::runtime_error If \p _log does not start with \p trace_magic.
+        ///
+        /// \since 4.2.11
+        explicit trace_reader(std::istream& _log)
+            : log_{_log}
+            , timestamp_{}
+        {
+            char magic[trace_magic.size()];
+
+            if (!log_.read(magic, sizeof(magic)) || std::string_view{magic, sizeof(magic)} != trace_magic) {
+                throw std::runtime_error{"trace_reader: stream is not an allocation trace."};
+            }
+        } // trace_reader
+
+        /// Decodes the next record.
+        ///
+        /// \param[out] _record Receives the record.
+        ///
+        /// \return False if the end of the trace was reached.
+        ///
+        /// \throws std::runtime_error If the trace is truncated or corrupt.
+        ///
+        /// \since 4.2.11
+        auto next(trace_record& _record) -> bool
+        {
+            const auto first = log_.get();
+
+            if (first == std::istream::traits_type::eof()) {
+                return false;
+            }
+
+            const auto alignment_log2 = static_cast<std::uint8_t>(first) >> 1;
+
+            if (alignment_log2 >= 64) {
+                throw std::runtime_error{fmt::format("trace_reader: invalid alignment [log2={}].", alignment_log2)};
+            }
+
+            timestamp_ += read_varint();
+
+            _record.operation = (first & 1) ? trace_operation::deallocate : trace_operation::allocate;
+            _record.timestamp = timestamp_;
+            _record.id = read_varint();
+            _record.bytes = static_cast<std::size_t>(read_varint());
+            _record.alignment = std::size_t{1} << alignment_log2;
+
+            return true;
+        } // next
+
+    private:
+        auto read_varint() -> std::uint64_t
+        {
+            std::uint64_t value = 0;
+
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                const auto c = log_.get();
+
+                if (c == std::istream::traits_type::eof()) {
+                    throw std::runtime_error{"trace_reader: trace is truncated."};
+                }
+
+                value |= std::uint64_t{static_cast<std::uint8_t>(c) & 0x7fu} << shift;
+
+                if ((c & 0x80) == 0) {
+                    return value;
+                }
+            }
+
+            throw std::runtime_error{"trace_reader: invalid integer in trace."};
+        } // read_varint
+
+        std::istream& log_;
+        std::uint64_t timestamp_;
+    }; // trace_reader
+
+    /// Reads every record of a trace into memory.
+    ///
+    /// \throws std::runtime_error If the trace is invalid (see \p trace_reader).
+    ///
+    /// \since 4.2.11
+    inline auto read_trace(std::istream& _log) -> std::vector<trace_record>
+    {
+        trace_reader reader{_log};
+        std::vector<trace_record> records;
+        trace_record r;
+
+        while (reader.next(r)) {
+            records.push_back(r);
+        }
+
+        return records;
+    } // read_trace
+} // namespace irods::experimental::pmr
+
+#endif // IRODS_TRACING_RESOURCE_HPP
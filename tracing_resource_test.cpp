@@ -0,0 +1,166 @@
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/container/pmr/global_resource.hpp>
+
+#include "test_support.hpp"
+#include "tracing_resource.hpp"
+
+namespace pmr = boost::container::pmr;
+namespace ie = irods::experimental::pmr;
+
+using ie::test::check;
+
+namespace
+{
+    auto test_records_round_trip() -> void
+    {
+        struct request
+        {
+            std::size_t bytes;
+            std::size_t alignment;
+        };
+
+        // The sizes cover LEB128 integers of one to three bytes, including the boundaries.
+        const std::vector<request> requests{{1, 1},
+                                            {127, 8},
+                                            {128, 16},
+                                            {300, 64},
+                                            {16'383, 4096},
+                                            {16'384, 2},
+                                            {1'000'000, 16}};
+
+        std::vector<ie::trace_record> expected;
+        std::stringstream log;
+
+        {
+            ie::tracing_resource resource{pmr::new_delete_resource(), log};
+            std::vector<void*> blocks;
+
+            for (std::size_t i = 0; i < requests.size(); ++i) {
+                const auto [bytes, alignment] = requests[i];
+                blocks.push_back(resource.allocate(bytes, alignment));
+                expected.push_back({ie::trace_operation::allocate, 0, i + 1, bytes, alignment});
+            }
+
+            check(resource.live_allocations() == requests.size(), "every allocation is live");
+
+            // Free in a different order than allocated, so that ids are not sequential.
+            for (std::size_t i = requests.size(); i-- > 0;) {
+                if (i % 2 == 0) {
+                    resource.deallocate(blocks[i], requests[i].bytes, requests[i].alignment);
+                    expected.push_back({ie::trace_operation::deallocate, 0, i + 1, requests[i].bytes, requests[i].alignment});
+                }
+            }
+
+            for (std::size_t i = 1; i < requests.size(); i += 2) {
+                resource.deallocate(blocks[i], requests[i].bytes, requests[i].alignment);
+                expected.push_back({ie::trace_operation::deallocate, 0, i + 1, requests[i].bytes, requests[i].alignment});
+            }
+
+            // Memory the resource did not hand out is passed on, but not recorded.
+            resource.deallocate(pmr::new_delete_resource()->allocate(64), 64);
+
+            check(resource.records() == expected.size(), "every operation was recorded");
+            check(resource.live_allocations() == 0, "no allocation is live");
+        }
+
+        const auto records = ie::read_trace(log);
+
+        check(records.size() == expected.size(), "every record was read back");
+
+        std::uint64_t timestamp = 0;
+
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const auto& r = records[i];
+            const auto& e = expected[i];
+
+            check(r.operation == e.operation, "the operation was read back");
+            check(r.id == e.id, "the id was read back");
+            check(r.bytes == e.bytes, "the size was read back");
+            check(r.alignment == e.alignment, "the alignment was read back");
+            check(r.timestamp >= timestamp, "the timestamps do not decrease");
+
+            timestamp = r.timestamp;
+        }
+    }
+
+    // Enough records to be written to the stream in several batches.
+    auto test_large_trace_round_trips() -> void
+    {
+        constexpr std::size_t count = 20'000;
+
+        std::stringstream log;
+
+        {
+            ie::tracing_resource resource{pmr::new_delete_resource(), log};
+
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto bytes = 1 + i % 5000;
+                resource.deallocate(resource.allocate(bytes), bytes);
+            }
+
+            check(log.str().size() > ie::tracing_resource::flush_threshold, "records were written before the flush");
+        }
+
+        ie::trace_reader reader{log};
+        ie::trace_record r;
+        std::size_t n = 0;
+
+        while (reader.next(r)) {
+            const auto i = n / 2;
+
+            check(r.operation == (n % 2 == 0 ? ie::trace_operation::allocate : ie::trace_operation::deallocate),
+                  "allocations and deallocations alternate");
+            check(r.id == i + 1, "the ids count up");
+            check(r.bytes == 1 + i % 5000, "the size was read back");
+
+            ++n;
+        }
+
+        check(n == 2 * count, "every record was read back");
+    }
+
+    auto test_invalid_traces_are_rejected() -> void
+    {
+        const auto rejects = [](const std::string& _trace) {
+            try {
+                std::istringstream in{_trace};
+                ie::read_trace(in);
+            }
+            catch (const std::runtime_error&) {
+                return true;
+            }
+
+            return false;
+        };
+
+        std::stringstream log;
+
+        {
+            ie::tracing_resource resource{pmr::new_delete_resource(), log};
+            resource.deallocate(resource.allocate(1000), 1000);
+        }
+
+        const auto trace = log.str();
+
+        check(!rejects(trace), "a complete trace is accepted");
+        check(rejects("NOTATRACE"), "a stream without the magic is rejected");
+        check(rejects(trace.substr(0, trace.size() - 1)), "a truncated record is rejected");
+        check(rejects(std::string{ie::trace_magic} + std::string(1, '\0') + std::string(11, '\xff')), "an oversized integer is rejected");
+        check(rejects(std::string{ie::trace_magic} + std::string(1, '\xff')), "an invalid alignment is rejected");
+    }
+} // anonymous namespace
+
+int main()
+{
+    return ie::test::run({
+        {"records_round_trip", test_records_round_trip},
+        {"large_trace_round_trips", test_large_trace_round_trips},
+        {"invalid_traces_are_rejected", test_invalid_traces_are_rejected}
+    });
+}